@@ -0,0 +1,272 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Batch Processing
+// Dan Jackson
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#include <windows.h>
+#else
+#define _DEFAULT_SOURCE		// glob()
+#include <glob.h>
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "batch.h"
+#include "thread.h"
+
+
+// Inputs to process, shared by the worker threads
+typedef struct
+{
+	omsummary_settings_t *settings;
+	char **filenames;
+	int numFilenames;
+	int capacityFilenames;
+	int next;					// Next input to process (guarded by the mutex)
+	int done;					// Number of inputs processed (guarded by the mutex)
+	int failed;					// Number of inputs that failed (guarded by the mutex)
+	thread_mutex_t mutex;
+} batch_t;
+
+
+// Add an input filename, returns false if out of memory
+static bool BatchAdd(batch_t *batch, const char *filename)
+{
+	if (batch->numFilenames + 1 > batch->capacityFilenames)
+	{
+		int capacity = 15 * batch->capacityFilenames / 10 + 16;	// Grow by ~1.5x
+		char **filenames = (char **)realloc(batch->filenames, capacity * sizeof(char *));
+		if (filenames == NULL) { return false; }
+		batch->filenames = filenames;
+		batch->capacityFilenames = capacity;
+	}
+	char *copy = (char *)malloc(strlen(filename) + 1);
+	if (copy == NULL) { return false; }
+	strcpy(copy, filename);
+	batch->filenames[batch->numFilenames++] = copy;
+	return true;
+}
+
+
+// Add the inputs matching a pattern (which may contain the wildcards '*' or '?'), returns the number of inputs added
+static int BatchAddPattern(batch_t *batch, const char *pattern)
+{
+	int count = 0;
+	if (strpbrk(pattern, "*?") == NULL)
+	{
+		// Not a pattern
+		if (BatchAdd(batch, pattern)) { count++; }
+		return count;
+	}
+#ifdef _WIN32
+	// Matches are relative to the pattern's directory
+	const char *name = pattern;
+	for (const char *p = pattern; *p != '\0'; p++)
+	{
+		if (*p == '\\' || *p == '/' || *p == ':') { name = p + 1; }
+	}
+	size_t directoryLength = name - pattern;
+	WIN32_FIND_DATAA findData;
+	HANDLE find = FindFirstFileA(pattern, &findData);
+	if (find != INVALID_HANDLE_VALUE)
+	{
+		do
+		{
+			if (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) { continue; }
+			char *filename = (char *)malloc(directoryLength + strlen(findData.cFileName) + 1);
+			if (filename == NULL) { break; }
+			memcpy(filename, pattern, directoryLength);
+			strcpy(filename + directoryLength, findData.cFileName);
+			if (BatchAdd(batch, filename)) { count++; }
+			free(filename);
+		} while (FindNextFileA(find, &findData));
+		FindClose(find);
+	}
+#else
+	glob_t matches;
+	if (glob(pattern, 0, NULL, &matches) == 0)
+	{
+		for (size_t i = 0; i < matches.gl_pathc; i++)
+		{
+			if (BatchAdd(batch, matches.gl_pathv[i])) { count++; }
+		}
+	}
+	globfree(&matches);
+#endif
+	return count;
+}
+
+
+// Returns whether a file exists
+static bool BatchFileExists(const char *filename)
+{
+	struct stat st;
+	return stat(filename, &st) == 0;
+}
+
+
+// Summarize one input, returns the reason for any failure, or NULL if successful
+static const char *BatchRunFile(omsummary_settings_t *batchSettings, const char *filename)
+{
+	size_t length = strlen(filename);
+	size_t suffixLength = strlen(BATCH_INPUT_SUFFIX);
+	if (!BatchFileExists(filename))
+	{
+		return "Input sleep file not found";
+	}
+	if (length < suffixLength || strcmp(filename + length - suffixLength, BATCH_INPUT_SUFFIX) != 0)
+	{
+		return "Input sleep file not of expected name (" BATCH_INPUT_SUFFIX ")";
+	}
+
+	// Derive the times and output filenames
+	size_t baseLength = length - suffixLength;
+	char *timesFilename = (char *)malloc(baseLength + strlen(BATCH_TIMES_SUFFIX) + 1);
+	char *outFilename = (char *)malloc(baseLength + strlen(BATCH_OUTPUT_SUFFIX) + 1);
+	if (timesFilename == NULL || outFilename == NULL)
+	{
+		free(timesFilename);
+		free(outFilename);
+		return "Out of memory";
+	}
+	memcpy(timesFilename, filename, baseLength);
+	strcpy(timesFilename + baseLength, BATCH_TIMES_SUFFIX);
+	memcpy(outFilename, filename, baseLength);
+	strcpy(outFilename + baseLength, BATCH_OUTPUT_SUFFIX);
+
+	const char *reason = NULL;
+	if (!BatchFileExists(timesFilename))
+	{
+		reason = "Times file not found";
+	}
+	else
+	{
+		// Each input is processed on a single thread
+		omsummary_settings_t settings = *batchSettings;
+		settings.filename = filename;
+		settings.timesFilename = timesFilename;
+		settings.outFilename = outFilename;
+		settings.threads = 1;
+		settings.quiet = 1;				// The status of each file is reported instead
+		if (OmSummaryRun(&settings) != 0)
+		{
+			reason = "Problem summarizing";
+		}
+	}
+
+	free(timesFilename);
+	free(outFilename);
+	return reason;
+}
+
+
+// Worker thread: process inputs until none remain
+static void *BatchWorker(void *arg)
+{
+	batch_t *batch = (batch_t *)arg;
+	for (;;)
+	{
+		ThreadMutexLock(&batch->mutex);
+		int index = batch->next++;
+		ThreadMutexUnlock(&batch->mutex);
+		if (index >= batch->numFilenames) { break; }
+
+		const char *filename = batch->filenames[index];
+		const char *reason = BatchRunFile(batch->settings, filename);
+
+		ThreadMutexLock(&batch->mutex);
+		batch->done++;
+		if (reason != NULL)
+		{
+			batch->failed++;
+			fprintf(stderr, "--- [%d/%d] ERROR: %s: %s\n", batch->done, batch->numFilenames, reason, filename);
+		}
+		else
+		{
+			fprintf(stderr, "--- [%d/%d] OK: %s\n", batch->done, batch->numFilenames, filename);
+		}
+		ThreadMutexUnlock(&batch->mutex);
+	}
+	return NULL;
+}
+
+
+// Summarize each input (or each match of a wildcard pattern) "*.sleep.csv" with its times "*.sleep.times.csv" to "*.sleep.summary.csv", on a pool of worker threads, returns the number of inputs that failed
+int OmSummaryBatch(omsummary_settings_t *settings, int numPatterns, const char *patterns[])
+{
+	batch_t batch;
+	memset(&batch, 0, sizeof(batch));
+	batch.settings = settings;
+
+	int failed = 0;
+	for (int i = 0; i < numPatterns; i++)
+	{
+		if (BatchAddPattern(&batch, patterns[i]) <= 0)
+		{
+			fprintf(stderr, "--- ERROR: No input files match: %s\n", patterns[i]);
+			failed++;
+		}
+	}
+
+	// Bounded pool of worker threads, the first worker runs on this thread
+	int numThreads = (settings->threads > 0) ? settings->threads : ThreadProcessorCount();
+	if (numThreads > batch.numFilenames) { numThreads = batch.numFilenames; }
+	thread_t *threads = (numThreads > 1) ? (thread_t *)calloc(numThreads, sizeof(thread_t)) : NULL;
+	ThreadMutexInit(&batch.mutex);
+	int started = 0;
+	if (threads != NULL)
+	{
+		for (int t = 1; t < numThreads; t++)
+		{
+			if (!ThreadCreate(&threads[started], BatchWorker, &batch)) { break; }
+			started++;
+		}
+	}
+	BatchWorker(&batch);
+	for (int t = 0; t < started; t++)
+	{
+		ThreadJoin(&threads[t]);
+	}
+	ThreadMutexDestroy(&batch.mutex);
+	free(threads);
+
+	failed += batch.failed;
+	fprintf(stderr, "--- Batch complete: %d of %d file(s) succeeded.\n", batch.numFilenames - batch.failed, batch.numFilenames);
+
+	for (int i = 0; i < batch.numFilenames; i++)
+	{
+		free(batch.filenames[i]);
+	}
+	free(batch.filenames);
+	return failed;
+}
@@ -0,0 +1,42 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Batch Processing
+// Dan Jackson
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "omsummary.h"
+
+// Input filename suffix, and the suffixes of the times and output files derived from it
+#define BATCH_INPUT_SUFFIX ".sleep.csv"
+#define BATCH_TIMES_SUFFIX ".sleep.times.csv"
+#define BATCH_OUTPUT_SUFFIX ".sleep.summary.csv"
+
+// Summarize each input (or each match of a wildcard pattern) "*.sleep.csv" with its times "*.sleep.times.csv" to "*.sleep.summary.csv", on a pool of worker threads, returns the number of inputs that failed
+int OmSummaryBatch(omsummary_settings_t *settings, int numPatterns, const char *patterns[]);
+
+#endif
@@ -0,0 +1,546 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Binary Caches of Parsed Data
+// Dan Jackson
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#include <windows.h>
+#include <io.h>
+#else
+#define _DEFAULT_SOURCE		// fileno(), fseeko()
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+
+// File times in nanoseconds
+#if defined(_WIN32)
+#define CACHE_FILE_TIME(st, field) ((int64_t)(st).st_ ## field ## time * 1000000000)
+#elif defined(__APPLE__)
+#define CACHE_FILE_TIME(st, field) ((int64_t)(st).st_ ## field ## timespec.tv_sec * 1000000000 + (st).st_ ## field ## timespec.tv_nsec)
+#else
+#define CACHE_FILE_TIME(st, field) ((int64_t)(st).st_ ## field ## tim.tv_sec * 1000000000 + (st).st_ ## field ## tim.tv_nsec)
+#endif
+
+// Cache file layout: header, followed by columns (each count * int64, in the writer's byte order)
+#define EVENT_CACHE_MAGIC "OMSCACHE"
+#define SEEK_INDEX_MAGIC "OMSINDEX"
+#define CHECKPOINT_MAGIC "OMSCHKPT"
+#define CACHE_VERSION 2
+#define CACHE_BYTE_ORDER 0x01020304
+#define CACHE_HASH_BLOCK (64 * 1024)		// Bytes hashed at the start and the end of the source file
+
+typedef struct
+{
+	char magic[8];				// EVENT_CACHE_MAGIC or SEEK_INDEX_MAGIC
+	uint32_t version;			// CACHE_VERSION
+	uint32_t byteOrder;			// CACHE_BYTE_ORDER, as written
+	uint32_t ticksPerSecond;	// TIME_TICKS_PER_SECOND of the writer
+	uint32_t numColumns;		// Number of columns
+	uint64_t sourceSize;		// Source file size
+	int64_t sourceModified;		// Source file modification time (nanoseconds)
+	uint64_t sourceHash;		// Hash of the first and last blocks of the source file
+	uint64_t sourceInode;		// Source file inode number
+	int64_t sourceChanged;		// Source file status change time (nanoseconds)
+	uint64_t count;				// Number of values in each column
+} cache_header_t;
+
+
+// FNV-1a hash of a block of data
+static uint64_t CacheHash(uint64_t hash, const unsigned char *data, size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= data[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+
+// Hash the first and last blocks of the first size bytes of a file
+static uint64_t CacheHashFile(FILE *fp, uint64_t size)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	unsigned char *block = (unsigned char *)malloc(CACHE_HASH_BLOCK);
+	if (block == NULL) { return 0; }
+
+	size_t length = fread(block, 1, (size < CACHE_HASH_BLOCK) ? (size_t)size : CACHE_HASH_BLOCK, fp);
+	hash = CacheHash(hash, block, length);
+	if (size > CACHE_HASH_BLOCK)
+	{
+		uint64_t offset = size - CACHE_HASH_BLOCK;
+		if (offset < CACHE_HASH_BLOCK) { offset = CACHE_HASH_BLOCK; }
+#ifdef _WIN32
+		int seek = _fseeki64(fp, (__int64)offset, SEEK_SET);
+#else
+		int seek = fseeko(fp, (off_t)offset, SEEK_SET);
+#endif
+		if (seek == 0)
+		{
+			length = fread(block, 1, (size_t)(size - offset), fp);
+			hash = CacheHash(hash, block, length);
+		}
+	}
+	free(block);
+	return hash;
+}
+
+
+// Continue a hash over all of the bytes of a file from an offset up to a size, returns false if they could not be read
+static bool CacheHashRange(FILE *fp, uint64_t offset, uint64_t size, uint64_t *hash)
+{
+#ifdef _WIN32
+	if (_fseeki64(fp, (__int64)offset, SEEK_SET) != 0) { return false; }
+#else
+	if (fseeko(fp, (off_t)offset, SEEK_SET) != 0) { return false; }
+#endif
+	unsigned char *block = (unsigned char *)malloc(CACHE_HASH_BLOCK);
+	if (block == NULL) { return false; }
+
+	uint64_t remaining = size - offset;
+	while (remaining > 0)
+	{
+		size_t length = fread(block, 1, (remaining < CACHE_HASH_BLOCK) ? (size_t)remaining : CACHE_HASH_BLOCK, fp);
+		if (length == 0) { break; }
+		*hash = CacheHash(*hash, block, length);
+		remaining -= length;
+	}
+	free(block);
+	return remaining == 0;
+}
+
+
+// Fingerprint a source file, returns false if it is not a readable regular file
+bool SourceFingerprint(const char *sourceFilename, source_fingerprint_t *fingerprint)
+{
+#ifdef _WIN32
+	struct _stat64 st;
+	if (_stat64(sourceFilename, &st) != 0 || !(st.st_mode & _S_IFREG)) { return false; }
+#else
+	struct stat st;
+	if (stat(sourceFilename, &st) != 0 || !S_ISREG(st.st_mode)) { return false; }
+#endif
+	fingerprint->size = (uint64_t)st.st_size;
+	fingerprint->modified = CACHE_FILE_TIME(st, m);
+	fingerprint->inode = (uint64_t)st.st_ino;
+	fingerprint->changed = CACHE_FILE_TIME(st, c);
+
+	FILE *fp = fopen(sourceFilename, "rb");
+	if (fp == NULL) { return false; }
+	fingerprint->hash = CacheHashFile(fp, fingerprint->size);
+	fclose(fp);
+	return true;
+}
+
+
+// Returns whether a source file still matches its fingerprint
+static bool SourceUnchanged(const char *sourceFilename, const source_fingerprint_t *fingerprint)
+{
+	source_fingerprint_t current;
+	return SourceFingerprint(sourceFilename, &current)
+		&& current.size == fingerprint->size
+		&& current.modified == fingerprint->modified
+		&& current.hash == fingerprint->hash
+		&& current.inode == fingerprint->inode
+		&& current.changed == fingerprint->changed;
+}
+
+
+// Fingerprint the start of a source file (that may have since been appended to), continuing from the fingerprint of a shorter prefix already checked (or NULL), returns false if it is not a readable regular file of at least that size
+bool SourcePrefixFingerprint(const char *sourceFilename, const source_fingerprint_t *checked, uint64_t size, source_fingerprint_t *fingerprint)
+{
+#ifdef _WIN32
+	struct _stat64 st;
+	if (_stat64(sourceFilename, &st) != 0 || !(st.st_mode & _S_IFREG)) { return false; }
+#else
+	struct stat st;
+	if (stat(sourceFilename, &st) != 0 || !S_ISREG(st.st_mode)) { return false; }
+#endif
+	if ((uint64_t)st.st_size < size || (checked != NULL && checked->size > size)) { return false; }
+	fingerprint->size = size;
+	fingerprint->modified = 0;
+	fingerprint->inode = 0;
+	fingerprint->changed = 0;
+
+	// The whole prefix is hashed (as any of the rows already read may have changed), other than any part already checked
+	FILE *fp = fopen(sourceFilename, "rb");
+	if (fp == NULL) { return false; }
+	fingerprint->hash = (checked != NULL) ? checked->hash : 0xcbf29ce484222325ULL;
+	bool ok = CacheHashRange(fp, (checked != NULL) ? checked->size : 0, size, &fingerprint->hash);
+	fclose(fp);
+	return ok;
+}
+
+
+// Grow the columns of a cache being built, returns false if out of memory
+static bool CacheGrow(const int64_t **columns[], int numColumns, size_t *capacity)
+{
+	size_t newCapacity = 2 * *capacity;
+	if (newCapacity < 4096) { newCapacity = 4096; }
+	for (int c = 0; c < numColumns; c++)
+	{
+		void *p = realloc((void *)*columns[c], newCapacity * sizeof(int64_t));
+		if (p == NULL) { return false; }
+		*columns[c] = (const int64_t *)p;
+	}
+	*capacity = newCapacity;
+	return true;
+}
+
+
+// Save columns to a cache file (after a fixed-size block of any extra data), returns false if there was a problem
+static bool CacheSave(const char *filename, const char *magic, const source_fingerprint_t *source, const void *extra, size_t extraLength, size_t count, const int64_t *columns[], int numColumns)
+{
+	cache_header_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, magic, sizeof(header.magic));
+	header.version = CACHE_VERSION;
+	header.byteOrder = CACHE_BYTE_ORDER;
+	header.ticksPerSecond = TIME_TICKS_PER_SECOND;
+	header.numColumns = (uint32_t)numColumns;
+	header.sourceSize = source->size;
+	header.sourceModified = source->modified;
+	header.sourceHash = source->hash;
+	header.sourceInode = source->inode;
+	header.sourceChanged = source->changed;
+	header.count = count;
+
+	// Write to a temporary file, then replace, so that a partial cache file is never seen
+	size_t filenameLength = strlen(filename);
+	char *tempFilename = (char *)malloc(filenameLength + 5);
+	if (tempFilename == NULL) { return false; }
+	memcpy(tempFilename, filename, filenameLength);
+	strcpy(tempFilename + filenameLength, ".tmp");
+
+	FILE *fp = fopen(tempFilename, "wb");
+	if (fp == NULL)
+	{
+		free(tempFilename);
+		return false;
+	}
+	bool ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+	ok = ok && (extraLength == 0 || fwrite(extra, extraLength, 1, fp) == 1);
+	for (int c = 0; c < numColumns && count > 0; c++)
+	{
+		ok = ok && fwrite(columns[c], sizeof(int64_t), count, fp) == count;
+	}
+	if (fclose(fp) != 0) { ok = false; }
+
+	if (ok)
+	{
+#ifdef _WIN32
+		remove(filename);
+#endif
+		ok = rename(tempFilename, filename) == 0;
+	}
+	if (!ok)
+	{
+		remove(tempFilename);
+	}
+	free(tempFilename);
+	return ok;
+}
+
+
+// Free the columns of a built cache, or the contents of a loaded cache file
+static void CacheFree(cache_file_t *file, const int64_t **columns[], int numColumns)
+{
+	if (file->data != NULL)
+	{
+#ifndef _WIN32
+		if (file->mapped)
+		{
+			munmap(file->data, file->length);
+		}
+		else
+#endif
+		{
+			free(file->data);
+		}
+	}
+	else
+	{
+		for (int c = 0; c < numColumns; c++)
+		{
+			free((void *)*columns[c]);
+		}
+	}
+	memset(file, 0, sizeof(cache_file_t));
+	for (int c = 0; c < numColumns; c++)
+	{
+		*columns[c] = NULL;
+	}
+}
+
+
+// Load the columns of a cache file (and copy any fixed-size block of extra data), returns false if it does not exist, is invalid, or does not match the current source file
+static bool CacheLoad(cache_file_t *file, const char *filename, const char *magic, const char *sourceFilename, void *extra, size_t extraLength, size_t *count, const int64_t **columns[], int numColumns)
+{
+	memset(file, 0, sizeof(cache_file_t));
+
+	FILE *fp = fopen(filename, "rb");
+	if (fp == NULL) { return false; }
+
+	// Load the contents
+#ifdef _WIN32
+	struct _stat64 st;
+	if (_fstat64(_fileno(fp), &st) != 0 || st.st_size < (__int64)(sizeof(cache_header_t) + extraLength)) { fclose(fp); return false; }
+#else
+	struct stat st;
+	if (fstat(fileno(fp), &st) != 0 || st.st_size < (off_t)(sizeof(cache_header_t) + extraLength)) { fclose(fp); return false; }
+#endif
+	file->length = (size_t)st.st_size;
+#ifndef _WIN32
+	void *data = mmap(NULL, file->length, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+	if (data != MAP_FAILED)
+	{
+		file->data = data;
+		file->mapped = true;
+	}
+	else
+#endif
+	{
+		file->data = malloc(file->length);
+		if (file->data == NULL || fread(file->data, 1, file->length, fp) != file->length)
+		{
+			fclose(fp);
+			free(file->data);
+			memset(file, 0, sizeof(cache_file_t));
+			return false;
+		}
+	}
+	fclose(fp);
+
+	// Check the header and that the contents match the current source file
+	const cache_header_t *header = (const cache_header_t *)file->data;
+	source_fingerprint_t source;
+	if (memcmp(header->magic, magic, sizeof(header->magic)) != 0
+		|| header->version != CACHE_VERSION
+		|| header->byteOrder != CACHE_BYTE_ORDER
+		|| header->ticksPerSecond != TIME_TICKS_PER_SECOND
+		|| header->numColumns != (uint32_t)numColumns
+		|| header->count > (file->length - sizeof(cache_header_t) - extraLength) / (numColumns * sizeof(int64_t))
+		|| file->length != sizeof(cache_header_t) + extraLength + numColumns * sizeof(int64_t) * header->count
+		|| !SourceFingerprint(sourceFilename, &source)
+		|| header->sourceSize != source.size
+		|| header->sourceModified != source.modified
+		|| header->sourceHash != source.hash
+		|| header->sourceInode != source.inode
+		|| header->sourceChanged != source.changed)
+	{
+		CacheFree(file, columns, 0);
+		return false;
+	}
+
+	*count = (size_t)header->count;
+	if (extraLength > 0)
+	{
+		memcpy(extra, (const char *)file->data + sizeof(cache_header_t), extraLength);
+	}
+	const int64_t *values = (const int64_t *)((const char *)file->data + sizeof(cache_header_t) + extraLength);
+	for (int c = 0; c < numColumns; c++)
+	{
+		*columns[c] = values + c * *count;
+	}
+	return true;
+}
+
+
+// Start building a cache of the events parsed from a source file, returns false if the source file could not be fingerprinted
+bool EventCacheInit(event_cache_t *cache, const char *sourceFilename)
+{
+	memset(cache, 0, sizeof(event_cache_t));
+	return SourceFingerprint(sourceFilename, &cache->source);
+}
+
+
+// Add a parsed event to a cache being built, returns false if out of memory
+bool EventCacheAdd(event_cache_t *cache, timestamp_t start, timestamp_t end, timestamp_t duration)
+{
+	if (cache->numEvents >= cache->capacity)
+	{
+		const int64_t **columns[] = { &cache->start, &cache->end, &cache->duration };
+		if (!CacheGrow(columns, 3, &cache->capacity)) { return false; }
+	}
+	((timestamp_t *)cache->start)[cache->numEvents] = start;
+	((timestamp_t *)cache->end)[cache->numEvents] = end;
+	((timestamp_t *)cache->duration)[cache->numEvents] = duration;
+	cache->numEvents++;
+	return true;
+}
+
+
+// Save a built cache to a file, returns false if there was a problem, or the source file has changed since the cache was started
+bool EventCacheSave(event_cache_t *cache, const char *cacheFilename, const char *sourceFilename)
+{
+	const int64_t *columns[] = { cache->start, cache->end, cache->duration };
+	if (!SourceUnchanged(sourceFilename, &cache->source)) { return false; }
+	return CacheSave(cacheFilename, EVENT_CACHE_MAGIC, &cache->source, NULL, 0, cache->numEvents, columns, 3);
+}
+
+
+// Load a cache file, returns false if it does not exist, is invalid, or does not match the current source file
+bool EventCacheLoad(event_cache_t *cache, const char *cacheFilename, const char *sourceFilename)
+{
+	memset(cache, 0, sizeof(event_cache_t));
+	const int64_t **columns[] = { &cache->start, &cache->end, &cache->duration };
+	return CacheLoad(&cache->file, cacheFilename, EVENT_CACHE_MAGIC, sourceFilename, NULL, 0, &cache->numEvents, columns, 3);
+}
+
+
+// Free a built or loaded cache
+void EventCacheClose(event_cache_t *cache)
+{
+	const int64_t **columns[] = { &cache->start, &cache->end, &cache->duration };
+	CacheFree(&cache->file, columns, 3);
+	memset(cache, 0, sizeof(event_cache_t));
+}
+
+
+// Start building a seek index of a source file, returns false if the source file could not be fingerprinted
+bool SeekIndexInit(seek_index_t *index, const char *sourceFilename)
+{
+	memset(index, 0, sizeof(seek_index_t));
+	return SourceFingerprint(sourceFilename, &index->source);
+}
+
+
+// Add an entry to an index being built: the latest end of all events before a line, and the line's byte offset and number, returns false if out of memory
+bool SeekIndexAdd(seek_index_t *index, timestamp_t maxEnd, size_t offset, int line)
+{
+	if (index->numEntries >= index->capacity)
+	{
+		const int64_t **columns[] = { &index->maxEnd, &index->offset, &index->line };
+		if (!CacheGrow(columns, 3, &index->capacity)) { return false; }
+	}
+	((int64_t *)index->maxEnd)[index->numEntries] = maxEnd;
+	((int64_t *)index->offset)[index->numEntries] = (int64_t)offset;
+	((int64_t *)index->line)[index->numEntries] = line;
+	index->numEntries++;
+	return true;
+}
+
+
+// Save a built index to a file, returns false if there was a problem, or the source file has changed since the index was started
+bool SeekIndexSave(seek_index_t *index, const char *indexFilename, const char *sourceFilename)
+{
+	const int64_t *columns[] = { index->maxEnd, index->offset, index->line };
+	if (!SourceUnchanged(sourceFilename, &index->source)) { return false; }
+	return CacheSave(indexFilename, SEEK_INDEX_MAGIC, &index->source, NULL, 0, index->numEntries, columns, 3);
+}
+
+
+// Load an index file, returns false if it does not exist, is invalid, or does not match the current source file
+bool SeekIndexLoad(seek_index_t *index, const char *indexFilename, const char *sourceFilename)
+{
+	memset(index, 0, sizeof(seek_index_t));
+	const int64_t **columns[] = { &index->maxEnd, &index->offset, &index->line };
+	return CacheLoad(&index->file, indexFilename, SEEK_INDEX_MAGIC, sourceFilename, NULL, 0, &index->numEntries, columns, 3);
+}
+
+
+// Find the last entry where all earlier events end before the given time (reading can start from there), returns -1 if none
+int SeekIndexFind(seek_index_t *index, timestamp_t time)
+{
+	// The latest end time never decreases through the file: binary search for the last entry before the time
+	size_t low = 0, high = index->numEntries;
+	while (low < high)
+	{
+		size_t mid = low + (high - low) / 2;
+		if (index->maxEnd[mid] < time) { low = mid + 1; }
+		else { high = mid; }
+	}
+	return (int)low - 1;
+}
+
+
+// Free a built or loaded index
+void SeekIndexClose(seek_index_t *index)
+{
+	const int64_t **columns[] = { &index->maxEnd, &index->offset, &index->line };
+	CacheFree(&index->file, columns, 3);
+	memset(index, 0, sizeof(seek_index_t));
+}
+
+
+// Save a checkpoint of the intervals' results and how far through the data file they reach (fingerprinting the times file, and the data file up to that offset, hashing only the data after any checkpoint resumed from), returns false if there was a problem
+bool CheckpointSave(checkpoint_t *checkpoint, const char *checkpointFilename, const char *timesFilename, const char *dataFilename, const checkpoint_state_t *resumed)
+{
+	source_fingerprint_t checked, data;
+	if (resumed != NULL)
+	{
+		memset(&checked, 0, sizeof(checked));
+		checked.size = (uint64_t)resumed->dataOffset;
+		checked.hash = resumed->dataHash;
+	}
+	if (!SourceFingerprint(timesFilename, &checkpoint->source) || !SourcePrefixFingerprint(dataFilename, (resumed != NULL) ? &checked : NULL, (uint64_t)checkpoint->state.dataOffset, &data))
+	{
+		return false;
+	}
+	checkpoint->state.dataHash = data.hash;
+	const int64_t *columns[] = { checkpoint->first, checkpoint->last, checkpoint->duration, checkpoint->count };
+	return CacheSave(checkpointFilename, CHECKPOINT_MAGIC, &checkpoint->source, &checkpoint->state, sizeof(checkpoint_state_t), checkpoint->numIntervals, columns, 4);
+}
+
+
+// Load a checkpoint, returns false if it does not exist, is invalid, does not match the current times file, or the data file no longer starts with the data already read
+bool CheckpointLoad(checkpoint_t *checkpoint, const char *checkpointFilename, const char *timesFilename, const char *dataFilename)
+{
+	memset(checkpoint, 0, sizeof(checkpoint_t));
+	const int64_t **columns[] = { &checkpoint->first, &checkpoint->last, &checkpoint->duration, &checkpoint->count };
+	if (!CacheLoad(&checkpoint->file, checkpointFilename, CHECKPOINT_MAGIC, timesFilename, &checkpoint->state, sizeof(checkpoint_state_t), &checkpoint->numIntervals, columns, 4))
+	{
+		return false;
+	}
+	source_fingerprint_t data;
+	if (checkpoint->state.dataOffset < 0 || !SourcePrefixFingerprint(dataFilename, NULL, (uint64_t)checkpoint->state.dataOffset, &data) || data.hash != checkpoint->state.dataHash)
+	{
+		CheckpointClose(checkpoint);
+		return false;
+	}
+	return true;
+}
+
+
+// Free a loaded checkpoint
+void CheckpointClose(checkpoint_t *checkpoint)
+{
+	const int64_t **columns[] = { &checkpoint->first, &checkpoint->last, &checkpoint->duration, &checkpoint->count };
+	if (checkpoint->file.data != NULL)
+	{
+		CacheFree(&checkpoint->file, columns, 4);
+	}
+	memset(checkpoint, 0, sizeof(checkpoint_t));
+}
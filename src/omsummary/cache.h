@@ -0,0 +1,160 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Binary Caches of Parsed Data
+// Dan Jackson
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "timestamp.h"
+
+// Rows of the data file between seek index entries
+#define SEEK_INDEX_ROWS 4096
+
+// Identifies the contents of a source file: its size, modification and status change times (to the nanosecond), inode, and a hash of its first and last blocks
+typedef struct
+{
+	uint64_t size;
+	int64_t modified;
+	uint64_t hash;
+	uint64_t inode;
+	int64_t changed;
+} source_fingerprint_t;
+
+// Contents of a loaded cache file
+typedef struct
+{
+	void *data;						// File contents
+	size_t length;					// Length of the contents
+	bool mapped;					// Contents are memory-mapped
+} cache_file_t;
+
+// Parsed events, held in columns: either built while parsing a source file and saved, or loaded from a saved cache file
+typedef struct
+{
+	size_t numEvents;				// Number of events
+	const timestamp_t *start;		// Start of each event
+	const timestamp_t *end;			// End of each event
+	const timestamp_t *duration;	// Duration of each event (the given duration, otherwise end - start)
+
+	// Private
+	size_t capacity;				// Capacity of the columns while building
+	source_fingerprint_t source;	// Source file the events were parsed from
+	cache_file_t file;				// Loaded cache file
+} event_cache_t;
+
+// Sparse index of a data file, an entry every SEEK_INDEX_ROWS rows: either built while parsing a source file and saved, or loaded from a saved index file
+typedef struct
+{
+	size_t numEntries;				// Number of entries
+	const int64_t *maxEnd;			// Latest end time of all events before each entry's line
+	const int64_t *offset;			// Byte offset of each entry's line
+	const int64_t *line;			// Line number of each entry's line
+
+	// Private
+	size_t capacity;				// Capacity of the columns while building
+	source_fingerprint_t source;	// Source file that is indexed
+	cache_file_t file;				// Loaded index file
+} seek_index_t;
+
+// Accumulated state of a run, where the data file was read up to
+typedef struct
+{
+	int64_t cursor;					// Sweep cursor
+	int64_t lastStart;				// Latest start of the events accumulated
+	int64_t dataOffset;				// Byte offset of the data file read up to
+	int64_t dataLine;				// Line number of the last line read
+	uint64_t dataHash;				// Hash of the data file up to the offset
+} checkpoint_state_t;
+
+// Checkpoint of the intervals' results: either to be saved (the caller's columns), or loaded from a saved checkpoint file
+typedef struct
+{
+	size_t numIntervals;			// Number of intervals
+	const int64_t *first;			// Results of each interval
+	const int64_t *last;
+	const int64_t *duration;
+	const int64_t *count;
+	checkpoint_state_t state;
+
+	// Private
+	source_fingerprint_t source;	// Times file of the intervals
+	cache_file_t file;				// Loaded checkpoint file
+} checkpoint_t;
+
+// Fingerprint a source file, returns false if it is not a readable regular file
+bool SourceFingerprint(const char *sourceFilename, source_fingerprint_t *fingerprint);
+
+// Fingerprint the start of a source file (that may have since been appended to), hashing all of it, continuing from the fingerprint of a shorter prefix already checked (or NULL), returns false if it is not a readable regular file of at least that size
+bool SourcePrefixFingerprint(const char *sourceFilename, const source_fingerprint_t *checked, uint64_t size, source_fingerprint_t *fingerprint);
+
+// Start building a cache of the events parsed from a source file, returns false if the source file could not be fingerprinted
+bool EventCacheInit(event_cache_t *cache, const char *sourceFilename);
+
+// Add a parsed event to a cache being built, returns false if out of memory
+bool EventCacheAdd(event_cache_t *cache, timestamp_t start, timestamp_t end, timestamp_t duration);
+
+// Save a built cache to a file, returns false if there was a problem, or the source file has changed since the cache was started
+bool EventCacheSave(event_cache_t *cache, const char *cacheFilename, const char *sourceFilename);
+
+// Load a cache file, returns false if it does not exist, is invalid, or does not match the current source file
+bool EventCacheLoad(event_cache_t *cache, const char *cacheFilename, const char *sourceFilename);
+
+// Free a built or loaded cache
+void EventCacheClose(event_cache_t *cache);
+
+// Start building a seek index of a source file, returns false if the source file could not be fingerprinted
+bool SeekIndexInit(seek_index_t *index, const char *sourceFilename);
+
+// Add an entry to an index being built: the latest end of all events before a line, and the line's byte offset and number, returns false if out of memory
+bool SeekIndexAdd(seek_index_t *index, timestamp_t maxEnd, size_t offset, int line);
+
+// Save a built index to a file, returns false if there was a problem, or the source file has changed since the index was started
+bool SeekIndexSave(seek_index_t *index, const char *indexFilename, const char *sourceFilename);
+
+// Load an index file, returns false if it does not exist, is invalid, or does not match the current source file
+bool SeekIndexLoad(seek_index_t *index, const char *indexFilename, const char *sourceFilename);
+
+// Find the last entry where all earlier events end before the given time (reading can start from there), returns -1 if none
+int SeekIndexFind(seek_index_t *index, timestamp_t time);
+
+// Free a built or loaded index
+void SeekIndexClose(seek_index_t *index);
+
+// Save a checkpoint of the intervals' results and how far through the data file they reach (fingerprinting the times file, and the data file up to that offset, hashing only the data after the checkpoint resumed from, or NULL), returns false if there was a problem
+bool CheckpointSave(checkpoint_t *checkpoint, const char *checkpointFilename, const char *timesFilename, const char *dataFilename, const checkpoint_state_t *resumed);
+
+// Load a checkpoint, returns false if it does not exist, is invalid, does not match the current times file, or the data file no longer starts with the data already read
+bool CheckpointLoad(checkpoint_t *checkpoint, const char *checkpointFilename, const char *timesFilename, const char *dataFilename);
+
+// Free a loaded checkpoint
+void CheckpointClose(checkpoint_t *checkpoint);
+
+#endif
@@ -29,45 +29,458 @@
 #ifdef _WIN32
 #define _CRT_SECURE_NO_WARNINGS
 #include <windows.h>
+#else
+#define _DEFAULT_SOURCE		// madvise(), fseeko()
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #endif
 
+#include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #include "csvload.h"
+#include "numeric.h"
 
 
-// Open a CSV file and optionally load the header line
-int CsvOpen(csv_load_t *csv, const char *filename, csv_header_t header, const char *separatorTypes)
+// Structural character positions within a block of CSV_BLOCK_SIZE bytes (one bit per byte)
+#define CSV_BLOCK_SIZE 64
+typedef struct
 {
-	memset(csv, 0, sizeof(csv_load_t));
+	uint64_t separator;
+	uint64_t quote;
+	uint64_t newline;
+} csv_block_t;
 
-	if (separatorTypes == NULL || separatorTypes[0] == '\0')
+
+// Classify a block of input in to separator, quote and newline masks
+static void CsvClassify(const char *p, char separator, csv_block_t *block)
+{
+#if defined(__AVX2__)
+	const __m256i vSeparator = _mm256_set1_epi8(separator);
+	const __m256i vQuote = _mm256_set1_epi8('"');
+	const __m256i vNewline = _mm256_set1_epi8('\n');
+	__m256i lo = _mm256_loadu_si256((const __m256i *)p);
+	__m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+	block->separator = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, vSeparator)) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, vSeparator)) << 32);
+	block->quote = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, vQuote)) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, vQuote)) << 32);
+	block->newline = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, vNewline)) | ((uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, vNewline)) << 32);
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	const __m128i vSeparator = _mm_set1_epi8(separator);
+	const __m128i vQuote = _mm_set1_epi8('"');
+	const __m128i vNewline = _mm_set1_epi8('\n');
+	block->separator = 0;
+	block->quote = 0;
+	block->newline = 0;
+	for (int i = 0; i < CSV_BLOCK_SIZE; i += 16)
 	{
-		csv->separatorTypes = ",";
+		__m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+		block->separator |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vSeparator)) << i;
+		block->quote |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vQuote)) << i;
+		block->newline |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, vNewline)) << i;
+	}
+#else
+	block->separator = 0;
+	block->quote = 0;
+	block->newline = 0;
+	for (int i = 0; i < CSV_BLOCK_SIZE; i++)
+	{
+		block->separator |= (uint64_t)(p[i] == separator) << i;
+		block->quote |= (uint64_t)(p[i] == '"') << i;
+		block->newline |= (uint64_t)(p[i] == '\n') << i;
+	}
+#endif
+	// No separator chosen (yet): the whole line is one token
+	if (separator == '\0')
+	{
+		block->separator = 0;
+	}
+}
+
+
+// Index of the lowest set bit (x != 0)
+static int CsvLowestBit(uint64_t x)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return (int)index;
+#else
+	return __builtin_ctzll(x);
+#endif
+}
+
+
+// Positions within quoted fields of a block: a quote opens a field only at the start of the field (stray quotes in an unquoted field are text), and a doubled quote within a field is one quote
+static uint64_t CsvQuoted(uint64_t quote, uint64_t boundary, bool fieldStart, bool *inQuotes, bool *closed)
+{
+	uint64_t quoted = 0;
+	int open = 0;					// Start of the current quoted run
+	int lastClose = *closed ? -1 : -2;	// Position of the last closing quote
+	while (quote != 0)
+	{
+		int bit = CsvLowestBit(quote);
+		quote &= quote - 1;
+		if (*inQuotes)
+		{
+			// Closing quote (or the first of a doubled quote)
+			quoted |= (bit > open) ? ((~0ULL >> (CSV_BLOCK_SIZE - (bit - open))) << open) : 0;
+			*inQuotes = false;
+			lastClose = bit;
+		}
+		else if (bit == lastClose + 1 || (bit == 0 ? fieldStart : ((boundary >> (bit - 1)) & 1) != 0))
+		{
+			// Opening quote, or a doubled quote continuing the field
+			*inQuotes = true;
+			open = bit;
+		}
+	}
+	if (*inQuotes)
+	{
+		quoted |= ~0ULL << open;
+	}
+	*closed = (lastClose == CSV_BLOCK_SIZE - 1);
+	return quoted;
+}
+
+
+#ifndef _WIN32
+// Map a regular file in to memory for sequential reading, returns false if the file cannot be mapped (e.g. stdin or a pipe)
+static bool CsvMap(csv_load_t *csv)
+{
+	struct stat st;
+	if (fstat(fileno(csv->fp), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+	{
+		return false;
+	}
+	void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fileno(csv->fp), 0);
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+	madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+	// The mapping remains valid after the file is closed
+	fclose(csv->fp);
+	csv->fp = NULL;
+	csv->data = (const char *)data;
+	csv->length = (size_t)st.st_size;
+	csv->mapped = true;
+	csv->eof = true;
+	return true;
+}
+#endif
+
+
+// Refill the input buffer (when not mapped), keeping any unread data, returns false if no more data could be read
+static bool CsvFill(csv_load_t *csv)
+{
+	if (csv->eof || (csv->fp == NULL && csv->read == NULL))
+	{
+		return false;
+	}
+
+	// Move the unread data to the start of the buffer
+	size_t remaining = csv->length - csv->offset;
+	if (remaining > 0 && csv->offset > 0)
+	{
+		memmove(csv->buffer, csv->buffer + csv->offset, remaining);
+	}
+	csv->position += csv->offset;
+	csv->offset = 0;
+	csv->length = remaining;
+
+	// A record longer than the buffer: grow the buffer
+	if (remaining >= csv->bufferSize)
+	{
+		size_t newSize = 2 * csv->bufferSize;
+		char *newBuffer = (char *)realloc(csv->buffer, newSize);
+		if (newBuffer == NULL)
+		{
+			fprintf(stderr, "ERROR: Problem growing CSV input buffer to %u bytes.\n", (unsigned int)newSize);
+			csv->error = true;
+			return false;
+		}
+		csv->buffer = newBuffer;
+		csv->bufferSize = newSize;
+		csv->data = csv->buffer;
+	}
+
+	size_t count;
+	if (csv->read != NULL)
+	{
+		count = csv->read(csv->readContext, csv->buffer + remaining, csv->bufferSize - remaining);
 	}
 	else
 	{
-		csv->separatorTypes = separatorTypes;
+		count = fread(csv->buffer + remaining, 1, csv->bufferSize - remaining, csv->fp);
 	}
-	csv->separator = '\0';
+	if (count == 0)
+	{
+		if (csv->fp != NULL && ferror(csv->fp))
+		{
+			fprintf(stderr, "ERROR: Problem reading CSV input.\n");
+			csv->error = true;
+		}
+		csv->eof = true;
+		return false;
+	}
+	csv->length += count;
+	return true;
+}
 
-	if (filename == NULL || filename[0] == '\0')
+
+// Choose the separator from the first of the possible separators that is found in the next line
+static void CsvDetectSeparator(csv_load_t *csv)
+{
+	const char *newline;
+	while ((newline = (const char *)memchr(csv->data + csv->offset, '\n', csv->length - csv->offset)) == NULL && CsvFill(csv));
+	const char *line = csv->data + csv->offset;
+	size_t len = (newline != NULL) ? (size_t)(newline - line) : (csv->length - csv->offset);
+
+	// Find the first of each of the possible separators...
+	for (const char *c = csv->separatorTypes; *c != '\0'; c++)
 	{
-		//fprintf(stderr, "ERROR: CSV file not specified.\n");
-		//return false;
-		csv->fp = stdin;
+		// ...if it exists...
+		if (memchr(line, *c, len) != NULL)
+		{
+			// ...use it as the separator for the file.
+			csv->separator = *c;
+			break;
+		}
+	}
+}
+
+
+// Grow storage (geometrically) to hold at least the given number of elements, returns false on allocation failure
+static bool CsvReserve(void **storage, int *capacity, int count, size_t elementSize)
+{
+	if (count <= *capacity)
+	{
+		return true;
+	}
+	int newCapacity = (*capacity > 0) ? *capacity : 16;
+	while (newCapacity < count) { newCapacity *= 2; }
+	void *newStorage = realloc(*storage, (size_t)newCapacity * elementSize);
+	if (newStorage == NULL)
+	{
+		fprintf(stderr, "ERROR: Problem allocating CSV storage.\n");
+		return false;
+	}
+	*storage = newStorage;
+	*capacity = newCapacity;
+	return true;
+}
+
+
+// Add a token for a field
+static void CsvAddToken(csv_load_t *csv, const char *start, const char *end)
+{
+	if (csv->numTokens >= csv->columnLimit)
+	{
+		return;
+	}
+	if (!CsvReserve((void **)&csv->tokens, &csv->tokenCapacity, csv->numTokens + 1, sizeof(csv_token_t)))
+	{
+		csv->columnLimit = csv->numTokens;
+		return;
+	}
+	csv_token_t *token = &csv->tokens[csv->numTokens++];
+	token->text = start;
+	token->length = (int)(end - start);
+}
+
+
+// Copy a quoted token to the string storage, without the quotes and with doubled quotes as one (the storage must have space for the token)
+static void CsvUnquoteToken(csv_load_t *csv, csv_token_t *token)
+{
+	char *str = csv->strings + csv->stringsLength;
+	int length = 0;
+	bool quoted = false;
+	const char *end = token->text + token->length;
+	for (const char *p = token->text; p < end; p++)
+	{
+		if (*p == '"')
+		{
+			if (quoted && p + 1 < end && p[1] == '"') { p++; }
+			else { quoted = !quoted; continue; }
+		}
+		str[length++] = *p;
+	}
+	str[length] = '\0';
+	csv->stringsLength += length + 1;
+	token->text = str;
+	token->length = length;
+}
+
+
+// Scan the next record, splitting fields at separators and the record at a newline (outside of quotes), returns false at the end of the data
+static bool CsvScanRecord(csv_load_t *csv)
+{
+	for (;;)
+	{
+		const char *record = csv->data + csv->offset;
+		const char *end = csv->data + csv->length;
+		const char *field = record;
+		const char *newline = NULL;
+		bool inQuotes = false;		// A block ends within quotes
+		bool closed = false;		// A block ends with a closing quote
+
+		csv->numTokens = 0;
+		csv->stringsLength = 0;
+
+		for (const char *p = record; p < end && newline == NULL; p += CSV_BLOCK_SIZE)
+		{
+			csv_block_t block;
+			if (end - p >= CSV_BLOCK_SIZE)
+			{
+				CsvClassify(p, csv->separator, &block);
+			}
+			else
+			{
+				// Final partial block, padded with non-structural bytes
+				char tail[CSV_BLOCK_SIZE] = { 0 };
+				memcpy(tail, p, (size_t)(end - p));
+				CsvClassify(tail, csv->separator, &block);
+			}
+
+			uint64_t quoted = inQuotes ? ~0ULL : 0;
+			if (block.quote != 0)
+			{
+				bool fieldStart = (p == record || p[-1] == '\n' || (csv->separator != '\0' && p[-1] == csv->separator));
+				quoted = CsvQuoted(block.quote, block.separator | block.newline, fieldStart, &inQuotes, &closed);
+			}
+			else
+			{
+				closed = false;
+			}
+			uint64_t structural = (block.separator | block.newline) & ~quoted;
+
+			// Once all required columns are found, only the end of the record is needed
+			if (csv->numTokens >= csv->columnLimit)
+			{
+				structural &= block.newline;
+			}
+
+			while (structural != 0)
+			{
+				int bit = CsvLowestBit(structural);
+				structural &= structural - 1;
+				const char *c = p + bit;
+				if (*c == '\n')
+				{
+					newline = c;
+					break;
+				}
+				CsvAddToken(csv, field, c);
+				field = c + 1;
+			}
+		}
+
+		// An incomplete record in the buffer: restart once more data is read (the buffer grows for long records)
+		if (newline == NULL && CsvFill(csv))
+		{
+			continue;
+		}
+
+		const char *recordEnd = end;
+		if (newline != NULL)
+		{
+			recordEnd = newline;
+			csv->offset = (size_t)(newline + 1 - csv->data);
+		}
+		else
+		{
+			if (record >= end || csv->wholeLines)
+			{
+				return false;
+			}
+			csv->offset = csv->length;
+		}
+
+		// Remove trailing CR
+		if (recordEnd > field && recordEnd[-1] == '\r') { recordEnd--; }
+
+		// Ignore the final token of completely blank lines
+		if (csv->numTokens > 0 || recordEnd > field)
+		{
+			CsvAddToken(csv, field, recordEnd);
+		}
+
+		// String storage for the record: unquoted tokens, and copies from CsvTokenString(), are never longer than the record
+		if (!CsvReserve((void **)&csv->strings, &csv->stringsCapacity, (int)(recordEnd - record) + csv->numTokens + 1, sizeof(char)))
+		{
+			csv->numTokens = 0;
+			return true;
+		}
+
+		for (int i = 0; i < csv->numTokens; i++)
+		{
+			csv_token_t *token = &csv->tokens[i];
+			if (csv->projection && !csv->projected[i])
+			{
+				// Columns not required by the caller are left empty
+				token->text = "";
+				token->length = 0;
+			}
+			else if (token->length > 0 && token->text[0] == '"')
+			{
+				// Quoted fields are copied without the quotes
+				CsvUnquoteToken(csv, token);
+			}
+		}
+		return true;
+	}
+}
+
+
+// Initialize the reader state
+static void CsvInit(csv_load_t *csv, const char *separatorTypes)
+{
+	memset(csv, 0, sizeof(csv_load_t));
+
+	if (separatorTypes == NULL || separatorTypes[0] == '\0')
+	{
+		csv->separatorTypes = ",";
 	}
 	else
 	{
-		csv->fp = fopen(filename, "rt");
+		csv->separatorTypes = separatorTypes;
 	}
+	csv->separator = '\0';
+	csv->columnLimit = INT_MAX;
+}
 
-	if (csv->fp == NULL) 
-	{ 
-		fprintf(stderr, "ERROR: Problem opening CSV file for input: %s\n", filename);
+
+// Allocate the input buffer, returns false if out of memory
+static bool CsvAllocateBuffer(csv_load_t *csv)
+{
+	csv->bufferSize = CSV_BUFFER_SIZE;
+	csv->buffer = (char *)malloc(csv->bufferSize);
+	if (csv->buffer == NULL)
+	{
+		fprintf(stderr, "ERROR: Problem allocating CSV input buffer.\n");
+		CsvClose(csv);
+		csv->error = true;
 		return false;
 	}
+	csv->data = csv->buffer;
+	return true;
+}
+
+
+// Optionally load the header line
+static int CsvReadHeader(csv_load_t *csv, csv_header_t header)
+{
 	csv->lineNumber = 0;
 	
 	// If we have a header
@@ -84,7 +497,7 @@ int CsvOpen(csv_load_t *csv, const char *filename, csv_header_t header, const ch
 			bool anyNumerical = false;
 			for (int i = 0; i < csv->numTokens; i++)
 			{
-				char c = csv->tokens[i][0];
+				char c = csv->tokens[i].length > 0 ? csv->tokens[i].text[0] : '\0';
 				if (c != '\0') { allEmpty = false; }
 				if (c == '-' || (c >= '0' && c <= '9')) { anyNumerical = true; }
 			}
@@ -102,82 +515,242 @@ int CsvOpen(csv_load_t *csv, const char *filename, csv_header_t header, const ch
 }
 
 
+// Open a CSV file and optionally load the header line
+int CsvOpen(csv_load_t *csv, const char *filename, csv_header_t header, const char *separatorTypes)
+{
+	CsvInit(csv, separatorTypes);
+
+	if (filename == NULL || filename[0] == '\0')
+	{
+		//fprintf(stderr, "ERROR: CSV file not specified.\n");
+		//return false;
+		csv->fp = stdin;
+	}
+	else
+	{
+		csv->fp = fopen(filename, "rb");
+	}
+
+	if (csv->fp == NULL) 
+	{ 
+		fprintf(stderr, "ERROR: Problem opening CSV file for input: %s\n", filename);
+		csv->error = true;
+		return false;
+	}
+
+	// Map regular files, otherwise use a large input buffer
+#ifndef _WIN32
+	if (csv->fp == stdin || !CsvMap(csv))
+#endif
+	{
+		if (!CsvAllocateBuffer(csv))
+		{
+			return false;
+		}
+	}
+	return CsvReadHeader(csv, header);
+}
+
+
+// Open a CSV stream read by a function (e.g. taking data from another thread), and optionally load the header line
+int CsvOpenStream(csv_load_t *csv, csv_read_t read, void *context, csv_header_t header, const char *separatorTypes)
+{
+	CsvInit(csv, separatorTypes);
+	csv->read = read;
+	csv->readContext = context;
+	if (!CsvAllocateBuffer(csv))
+	{
+		return false;
+	}
+	return CsvReadHeader(csv, header);
+}
+
+
+// Register a column required by the caller: once any are registered, other columns are not tokenized and rows are only scanned up to the highest required column
+void CsvProjectColumn(csv_load_t *csv, int index)
+{
+	if (index < 0 || !CsvReserve((void **)&csv->projected, &csv->projectedCapacity, index + 1, sizeof(bool)))
+	{
+		return;
+	}
+	if (!csv->projection)
+	{
+		csv->projection = true;
+		csv->columnLimit = 0;
+		memset(csv->projected, 0, csv->projectedCapacity * sizeof(bool));
+	}
+	for (int i = csv->columnLimit; i < index; i++)
+	{
+		csv->projected[i] = false;
+	}
+	csv->projected[index] = true;
+	if (index + 1 > csv->columnLimit)
+	{
+		csv->columnLimit = index + 1;
+	}
+}
+
+
 // Read the next row of CSV data, returns number of columns of data (<0 = EOF)
 int CsvReadLine(csv_load_t *csv)
 {
 	// Was a line pushed back ("unread")?
 	if (csv->pushed)
 	{
-		// Return this line instead
+		// Return this line instead (the buffer is only refilled when reading a new line)
 		csv->pushed = false;
 	}
 	else
 	{
-		// Read line
-		if (csv->fp == NULL || fgets(csv->line, sizeof(csv->line) / sizeof(csv->line[0]), csv->fp) == NULL)
+		// If we have not determined the separator yet...
+		if (csv->data != NULL && csv->separator == '\0')
+		{
+			CsvDetectSeparator(csv);
+		}
+
+		// Read and tokenize the next record
+		csv->lineNumber++;
+		csv->lineOffset = csv->position + csv->offset;
+		if (csv->data == NULL || !CsvScanRecord(csv))
 		{
 			// End of file
+			csv->lineNumber--;
 			csv->numTokens = -1;
 		}
-		else
-		{
-			csv->lineNumber++;
+	}
+	return csv->numTokens;
+}
 
-			// Remove trailing CR/LF
-			int len = (int)strlen(csv->line);
-			if (len > 0 && csv->line[len - 1] == '\n') { csv->line[len - 1] = '\0'; len--; }
-			if (len > 0 && csv->line[len - 1] == '\r') { csv->line[len - 1] = '\0'; len--; }
 
-			// TODO: write a custom parser to cope with quoted strings including commas
-			// Parse comma-separated tokens
-			csv->numTokens = 0;
+// Get current line number of CSV file
+int CsvLineNumber(csv_load_t *csv)
+{
+	return csv->lineNumber;
+}
 
-			// If we have not determined the separator yet...
-			if (csv->separator == '\0')
-			{
-				// Find the first of each of the possible separators...
-				for (const char *c = csv->separatorTypes; *c != '\0'; c++)
-				{
-					// ...if it exists...
-					if (strchr(csv->line, *c) != NULL)
-					{
-						// ...use it as the separator for the file.
-						csv->separator = *c;
-						break;
-					}
-				}
-			}
 
-			// Tokenize
-			char seps[4] = "";
-			if (csv->separator != '\0')
-			{
-				sprintf(seps, "%c", csv->separator);
-			}
-			strcat(seps, "\r\n");
-			for (char *token = strtok(csv->line, seps); token != NULL; token = strtok(NULL, seps))
-			{
-				if (csv->numTokens < sizeof(csv->tokens) / sizeof(csv->tokens[0]))
-				{
-					csv->tokens[csv->numTokens] = token;
-					csv->numTokens++;
-				}
-				else
-				{
-					fprintf(stderr, "WARNING: Too many columns in CSV on line %d, ignoring after token %d.\n", csv->lineNumber, csv->numTokens);
-					break;
-				}
-			}
+// Get the byte offset of the start of the current line in the CSV file
+size_t CsvLineOffset(csv_load_t *csv)
+{
+	return csv->lineOffset;
+}
+
+
+// Returns whether there was a problem opening or reading the input
+bool CsvError(csv_load_t *csv)
+{
+	return csv->error;
+}
+
+
+// Set whether only newline-terminated lines are read (a partial last line is left unread)
+void CsvWholeLines(csv_load_t *csv, bool wholeLines)
+{
+	csv->wholeLines = wholeLines;
+}
+
+
+// Seek to the start of a line at a byte offset (from CsvLineOffset()), to be read next as the given line number, returns false if the input cannot seek
+bool CsvSeek(csv_load_t *csv, size_t offset, int lineNumber)
+{
+	if (csv->data == NULL)
+	{
+		return false;
+	}
+	if (csv->mapped || (offset >= csv->position && offset <= csv->position + csv->length))
+	{
+		// Within the mapped file or the buffered input
+		if (offset < csv->position || offset - csv->position > csv->length)
+		{
+			return false;
 		}
+		csv->offset = offset - csv->position;
 	}
-	return csv->numTokens;
+	else
+	{
+		// Reposition the buffered input
+		if (csv->fp == NULL || csv->fp == stdin)
+		{
+			return false;
+		}
+#ifdef _WIN32
+		int seek = _fseeki64(csv->fp, (__int64)offset, SEEK_SET);
+#else
+		int seek = fseeko(csv->fp, (off_t)offset, SEEK_SET);
+#endif
+		if (seek != 0)
+		{
+			return false;
+		}
+		csv->position = offset;
+		csv->offset = 0;
+		csv->length = 0;
+		csv->eof = false;
+	}
+	csv->pushed = false;
+	csv->lineNumber = lineNumber - 1;
+	return true;
 }
 
 
-// Get current line number of CSV file
-int CsvLineNumber(csv_load_t *csv)
+// Get the lines after the current line of a memory-mapped CSV file that has no quoted fields (so that it can be divided at any newline): the byte range and the first line number, returns false if it cannot be divided
+bool CsvRemaining(csv_load_t *csv, size_t *begin, size_t *end, int *lineNumber)
 {
-	return csv->lineNumber;
+	if (!csv->mapped)
+	{
+		return false;
+	}
+	size_t offset = csv->offset;
+	if (offset < csv->length && memchr(csv->data + offset, '"', csv->length - offset) != NULL)
+	{
+		return false;
+	}
+	*begin = offset;
+	*end = csv->length;
+	if (csv->wholeLines)
+	{
+		while (*end > offset && csv->data[*end - 1] != '\n') { (*end)--; }
+	}
+	*lineNumber = csv->lineNumber + 1;
+	return true;
+}
+
+
+// Get the byte offset just after the end of the line containing an offset in a memory-mapped CSV file (or the end of the file)
+size_t CsvLineEnd(csv_load_t *csv, size_t offset)
+{
+	if (offset >= csv->length)
+	{
+		return csv->length;
+	}
+	const char *newline = (const char *)memchr(csv->data + offset, '\n', csv->length - offset);
+	return (newline != NULL) ? (size_t)(newline + 1 - csv->data) : csv->length;
+}
+
+
+// Open a reader for a byte range of whole lines of a memory-mapped CSV file, sharing its mapping, separator and column projection (line numbers are counted from the start of the range), returns false if out of memory
+bool CsvOpenRange(csv_load_t *range, csv_load_t *csv, size_t begin, size_t end)
+{
+	memset(range, 0, sizeof(csv_load_t));
+	range->data = csv->data + begin;
+	range->length = end - begin;
+	range->position = begin;
+	range->eof = true;
+	range->separatorTypes = csv->separatorTypes;
+	range->separator = csv->separator;
+	range->columnLimit = csv->columnLimit;
+	range->projection = csv->projection;
+	if (csv->projectedCapacity > 0)
+	{
+		range->projected = (bool *)malloc(csv->projectedCapacity * sizeof(bool));
+		if (range->projected == NULL)
+		{
+			return false;
+		}
+		memcpy(range->projected, csv->projected, csv->projectedCapacity * sizeof(bool));
+		range->projectedCapacity = csv->projectedCapacity;
+	}
+	return true;
 }
 
 
@@ -188,28 +761,71 @@ int CsvTokenCount(csv_load_t *csv)
 }
 
 
-// Get CSV token string
+// Get CSV token string (NUL-terminated copy, valid until the next line is read)
 char *CsvTokenString(csv_load_t *csv, int index)
 {
 	if (index < 0 || index >= csv->numTokens)
 	{
 		return "";
 	}
-	return csv->tokens[index];
+
+	// Already copied?
+	csv_token_t *token = &csv->tokens[index];
+	if (token->text >= csv->strings && token->text < csv->strings + csv->stringsLength)
+	{
+		return (char *)token->text;
+	}
+
+	// The string storage is reserved for copies of every token on the line
+	int length = token->length;
+	char *str = csv->strings + csv->stringsLength;
+	memcpy(str, token->text, length);
+	str[length] = '\0';
+	csv->stringsLength += length + 1;
+	token->text = str;
+	token->length = length;
+	return str;
+}
+
+
+// Get CSV token as a view in to the input (not NUL-terminated), valid until the next line is read
+const char *CsvTokenSpan(csv_load_t *csv, int index, int *length)
+{
+	if (index < 0 || index >= csv->numTokens)
+	{
+		*length = 0;
+		return "";
+	}
+	*length = csv->tokens[index].length;
+	return csv->tokens[index].text;
 }
 
 
-// Get CSV token integer
+// Get CSV token integer (0 if not an integer)
 int CsvTokenInt(csv_load_t *csv, int index)
 {
-	return (int)strtol(CsvTokenString(csv, index), NULL, 0);
+	int value = 0;
+	int length;
+	const char *token = CsvTokenSpan(csv, index, &length);
+	if (!NumericParseInt(token, (size_t)length, &value))
+	{
+		return 0;
+	}
+	return value;
 }
 
 
-// Get CSV token double
+// Get CSV token double (0 if not a number)
 double CsvTokenFloat(csv_load_t *csv, int index)
 {
-	return atof(CsvTokenString(csv, index));
+	double value = 0;
+	int length;
+	const char *token = CsvTokenSpan(csv, index, &length);
+	if (!NumericParseDouble(token, (size_t)length, &value))
+	{
+		return 0;
+	}
+	return value;
 }
 
 
@@ -217,6 +833,29 @@ double CsvTokenFloat(csv_load_t *csv, int index)
 void CsvClose(csv_load_t *csv)
 {
 	csv->numTokens = -1;
+#ifndef _WIN32
+	if (csv->mapped)
+	{
+		munmap((void *)csv->data, csv->length);
+		csv->mapped = false;
+	}
+#endif
+	csv->data = NULL;
+	csv->length = 0;
+	csv->offset = 0;
+	free(csv->buffer);
+	csv->buffer = NULL;
+	free(csv->tokens);
+	csv->tokens = NULL;
+	csv->tokenCapacity = 0;
+	free(csv->strings);
+	csv->strings = NULL;
+	csv->stringsCapacity = 0;
+	free(csv->projected);
+	csv->projected = NULL;
+	csv->projectedCapacity = 0;
+	csv->read = NULL;
+	csv->readContext = NULL;
 	if (csv->fp != NULL)
 	{
 		if (csv->fp != stdin)
@@ -226,4 +865,3 @@ void CsvClose(csv_load_t *csv)
 		csv->fp = NULL;
 	}
 }
-
@@ -27,34 +27,80 @@
 // Dan Jackson
 
 
-// TODO: Add proper parsing of quoted strings (including quotes-within-quotes, possibly strings containing new-lines?)
 // TODO: Add specific header size (e.g. allow specified count, detect on specific string, and detect '---' prefix and treat as header lines until similar found -- requires multi-line detection).
 
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 
-#define CSV_MAX_LINE	1024
-#define CSV_MAX_TOKENS	128
+#define CSV_BUFFER_SIZE	(1024 * 1024)		// Initial input buffer size when the file cannot be mapped (e.g. stdin or a pipe), grows for longer records
 
 typedef struct
 {
-	FILE *fp;							// CSV file pointer
+	const char *text;					// Token start (only NUL-terminated once returned by CsvTokenString())
+	int length;							// Token length
+} csv_token_t;
+
+// Read function for streamed input: reads up to size bytes in to the buffer, returns the number of bytes read (0 at the end of the input)
+typedef size_t (*csv_read_t)(void *context, void *buffer, size_t size);
+
+typedef struct
+{
+	FILE *fp;							// CSV file pointer (buffered input only)
+	csv_read_t read;					// Read function (streamed input only)
+	void *readContext;					// Read function context
+	const char *data;					// Input data: the mapped file, or the contents of the buffer
+	size_t length;						// Length of the input data
+	size_t offset;						// Offset of the next unread line in the input data
+	size_t position;					// File offset of the start of the input data
+	size_t lineOffset;					// File offset of the start of the current line
+	bool mapped;						// The input data is a memory-mapped file
+	char *buffer;						// Buffered input storage (when not mapped)
+	size_t bufferSize;					// Size of the buffered input storage
+	bool eof;							// No more buffered input to read
 	int lineNumber;						// Current line number
-	char line[CSV_MAX_LINE];			// Line buffer
-	char *tokens[CSV_MAX_TOKENS];		// Parsed token pointers
+	csv_token_t *tokens;				// Parsed token views in to the input data (reused for each line)
+	int tokenCapacity;					// Allocated token count
 	int numTokens;						// Token count
+	int columnLimit;					// Stop tokenizing after this many columns (one past the highest projected column)
+	bool projection;					// Only the projected columns are tokenized
+	bool *projected;					// Columns required by the caller
+	int projectedCapacity;				// Allocated projected column count
+	char *strings;						// Storage for the unquoted and NUL-terminated copies of tokens on the current line (reused for each line)
+	int stringsCapacity;				// Allocated string storage
+	int stringsLength;					// Used string storage
 	bool pushed;						// The last line was "unread", return again
 	const char *separatorTypes;			// Possible field separator characters
 	char separator;						// Chosen field separator character
+	bool error;							// There was a problem opening or reading the input
+	bool wholeLines;					// Only newline-terminated lines are read (a partial last line is left unread)
 } csv_load_t;
 
 int CsvLineNumber(csv_load_t *csv);
 
+size_t CsvLineOffset(csv_load_t *csv);
+
+// Returns whether there was a problem opening or reading the input
+bool CsvError(csv_load_t *csv);
+
+// Set whether only newline-terminated lines are read: a partial last line (e.g. still being written) is left unread, and the end of the input is at the start of it (until it is cleared)
+void CsvWholeLines(csv_load_t *csv, bool wholeLines);
+
+bool CsvSeek(csv_load_t *csv, size_t offset, int lineNumber);
+
+bool CsvRemaining(csv_load_t *csv, size_t *begin, size_t *end, int *lineNumber);
+
+size_t CsvLineEnd(csv_load_t *csv, size_t offset);
+
+bool CsvOpenRange(csv_load_t *range, csv_load_t *csv, size_t begin, size_t end);
+
 int CsvTokenCount(csv_load_t *csv);
 
 char *CsvTokenString(csv_load_t *csv, int index);
 
+const char *CsvTokenSpan(csv_load_t *csv, int index, int *length);
+
 int CsvTokenInt(csv_load_t *csv, int index);
 
 double CsvTokenFloat(csv_load_t *csv, int index);
@@ -69,6 +115,8 @@ typedef enum
 #define CSV_SEPARATORS "\t;,"
 
 int CsvOpen(csv_load_t *csv, const char *filename, csv_header_t header, const char *separatorTypes);
+int CsvOpenStream(csv_load_t *csv, csv_read_t read, void *context, csv_header_t header, const char *separatorTypes);
+void CsvProjectColumn(csv_load_t *csv, int index);
 int CsvReadLine(csv_load_t *csv);
 void CsvClose(csv_load_t *csv);
 
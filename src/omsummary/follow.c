@@ -0,0 +1,185 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Following a Growing File
+// Dan Jackson
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#include <windows.h>
+#else
+#define _DEFAULT_SOURCE		// fileno()
+#include <unistd.h>
+#include <poll.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "follow.h"
+#include "thread.h"
+
+
+// Open a file to follow, returns false if it could not be opened
+bool FollowReaderOpen(follow_reader_t *reader, const char *filename, volatile sig_atomic_t *stop, void (*idle)(void *context), void *idleContext)
+{
+	memset(reader, 0, sizeof(follow_reader_t));
+	reader->notify = -1;
+	reader->watch = -1;
+	reader->stop = stop;
+	reader->idle = idle;
+	reader->idleContext = idleContext;
+	reader->fp = fopen(filename, "rb");
+	if (reader->fp == NULL)
+	{
+		return false;
+	}
+
+	// Be notified of changes to the file (otherwise poll)
+#ifdef __linux__
+	reader->notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (reader->notify >= 0)
+	{
+		reader->watch = inotify_add_watch(reader->notify, filename, IN_MODIFY);
+		if (reader->watch < 0)
+		{
+			close(reader->notify);
+			reader->notify = -1;
+		}
+	}
+#endif
+	return true;
+}
+
+
+// Wait for the file to change (or a signal, or a while)
+static void FollowWait(follow_reader_t *reader)
+{
+#ifdef __linux__
+	if (reader->notify >= 0)
+	{
+		struct pollfd pfd;
+		pfd.fd = reader->notify;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, 1000) > 0)
+		{
+			char events[4096];
+			while (read(reader->notify, events, sizeof(events)) > 0) { ; }
+		}
+		return;
+	}
+#endif
+	ThreadSleep(FOLLOW_POLL_INTERVAL);
+}
+
+
+// Read up to size bytes of complete lines in to the buffer, waiting for more at the end of the file, returns the number of bytes read (0 once stopped), usable as a csv_read_t
+size_t FollowRead(void *context, void *buffer, size_t size)
+{
+	follow_reader_t *reader = (follow_reader_t *)context;
+	char *data = (char *)buffer;
+	for (;;)
+	{
+		// Start with the held-back partial line
+		size_t length = (reader->partialLength < size) ? reader->partialLength : size;
+		memcpy(data, reader->partial, length);
+		memmove(reader->partial, reader->partial + length, reader->partialLength - length);
+		reader->partialLength -= length;
+		size_t count = 0;
+		if (length < size)
+		{
+			count = fread(data + length, 1, size - length, reader->fp);
+			length += count;
+		}
+
+		// Pass on up to the end of the last complete line (or a whole buffer without one)
+		size_t complete = length;
+		while (complete > 0 && data[complete - 1] != '\n') { complete--; }
+		if (complete == 0 && length >= size)
+		{
+			return length;
+		}
+
+		// Hold back the partial last line
+		size_t partial = length - complete;
+		if (reader->partialLength + partial > reader->partialCapacity)
+		{
+			size_t capacity = 15 * reader->partialCapacity / 10 + partial + 256;	// Grow by ~1.5x
+			char *p = (char *)realloc(reader->partial, capacity);
+			if (p == NULL)
+			{
+				return complete;		// (partial line dropped)
+			}
+			reader->partial = p;
+			reader->partialCapacity = capacity;
+		}
+		memmove(reader->partial + partial, reader->partial, reader->partialLength);
+		memcpy(reader->partial, data + complete, partial);
+		reader->partialLength += partial;
+		if (complete > 0)
+		{
+			return complete;
+		}
+
+		// At the end of the file: wait for more (unless stopped)
+		if (count == 0)
+		{
+			if (reader->stop != NULL && *reader->stop)
+			{
+				return 0;
+			}
+			if (reader->idle != NULL)
+			{
+				reader->idle(reader->idleContext);
+			}
+			FollowWait(reader);
+			clearerr(reader->fp);
+		}
+	}
+}
+
+
+// Close the followed file, returns the length of any partial last line that was not read
+size_t FollowReaderClose(follow_reader_t *reader)
+{
+	size_t partialLength = reader->partialLength;
+#ifdef __linux__
+	if (reader->notify >= 0)
+	{
+		close(reader->notify);
+	}
+#endif
+	if (reader->fp != NULL)
+	{
+		fclose(reader->fp);
+	}
+	free(reader->partial);
+	memset(reader, 0, sizeof(follow_reader_t));
+	return partialLength;
+}
@@ -0,0 +1,62 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Following a Growing File
+// Dan Jackson
+
+#ifndef FOLLOW_H
+#define FOLLOW_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <signal.h>
+
+#define FOLLOW_POLL_INTERVAL 250		// Milliseconds between checks for more data (when change notifications are not available)
+
+// Reads a file that is being appended to: at the end of the file, waits for more lines (until stopped), only ever passing on complete lines
+typedef struct
+{
+	FILE *fp;							// File being followed
+	int notify;							// Change notification descriptor (-1 to poll)
+	int watch;							// Change notification watch
+	char *partial;						// Held-back partial last line
+	size_t partialLength;
+	size_t partialCapacity;
+	volatile sig_atomic_t *stop;		// Set (e.g. by a signal handler) to stop following at the end of the data
+	void (*idle)(void *context);		// Called before waiting for more data (e.g. to flush output)
+	void *idleContext;
+} follow_reader_t;
+
+// Open a file to follow, returns false if it could not be opened
+bool FollowReaderOpen(follow_reader_t *reader, const char *filename, volatile sig_atomic_t *stop, void (*idle)(void *context), void *idleContext);
+
+// Read up to size bytes of complete lines in to the buffer, waiting for more at the end of the file, returns the number of bytes read (0 once stopped), usable as a csv_read_t
+size_t FollowRead(void *reader, void *buffer, size_t size);
+
+// Close the followed file, returns the length of any partial last line that was not read
+size_t FollowReaderClose(follow_reader_t *reader);
+
+#endif
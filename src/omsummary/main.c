@@ -37,6 +37,7 @@
 #include <stdbool.h>
 
 #include "omsummary.h"
+#include "batch.h"
 
 
 static double scale(const char *str)
@@ -67,16 +68,13 @@ int main(int argc, char *argv[])
 	int i;
 	bool help = false;
 	int positional = 0;
+	bool batch = false;
+	const char **inputs = (const char **)calloc(argc, sizeof(const char *));
 	int ret;
-	omsummary_settings_t settings = { 0 };
+	omsummary_settings_t settings;
 
 	// Default settings
-	memset(&settings, 0, sizeof(settings));
-	settings.scale = 1.0f;				// "1/60" for minutes
-	settings.scaleProp = 1.0f;			// "100" for percentage
-	settings.countOffset = 0;			// "-1" to report count-1
-	settings.header = NULL;
-	settings.separator = NULL;
+	OmSummarySettingsInit(&settings);
 
 	for (i = 1; i < argc; i++)
 	{
@@ -109,6 +107,15 @@ int main(int argc, char *argv[])
 		else if (strcmp(argv[i], "-scaleprop") == 0) { settings.scaleProp = scale(argv[++i]); }
 		else if (strcmp(argv[i], "-countoffset") == 0) { settings.countOffset = atoi(argv[++i]); }
 		else if (strcmp(argv[i], "-header") == 0) { settings.header = argv[++i]; }
+		else if (strcmp(argv[i], "-threads") == 0) { settings.threads = atoi(argv[++i]); }
+		else if (strcmp(argv[i], "-cache") == 0) { settings.cache = 1; }
+		else if (strcmp(argv[i], "-index") == 0) { settings.index = 1; }
+		else if (strcmp(argv[i], "-pipeline") == 0) { settings.pipeline = 1; }
+		else if (strcmp(argv[i], "-sortmemory") == 0) { settings.sortMemory = atoi(argv[++i]); }
+		else if (strcmp(argv[i], "-stream") == 0) { settings.stream = 1; }
+		else if (strcmp(argv[i], "-follow") == 0) { settings.follow = 1; }
+		else if (strcmp(argv[i], "-checkpoint") == 0) { settings.checkpoint = argv[++i]; }
+		else if (strcmp(argv[i], "-batch") == 0) { batch = true; }
 		else if (strcmp(argv[i], "-separator") == 0)
 		{
 			settings.separator = argv[++i];
@@ -128,17 +135,21 @@ int main(int argc, char *argv[])
 			{
 				settings.filename = argv[i];
 			}
-			else
-			{
-				fprintf(stderr, "Unknown positional parameter (%d): %s\n", positional + 1, argv[i]);
-				help = 1;
-			}
-			positional++;
+			inputs[positional++] = argv[i];
 		}
 	}
 
 
-	if (settings.timesFilename == NULL) { fprintf(stderr, "ERROR: Times file not specified.\n"); help = 1; }
+	if (batch)
+	{
+		if (positional == 0) { fprintf(stderr, "ERROR: No batch input files specified.\n"); help = 1; }
+		if (settings.timesFilename != NULL || settings.outFilename != NULL) { fprintf(stderr, "WARNING: Times and output files are derived from each input file in batch mode.\n"); }
+	}
+	else
+	{
+		if (positional > 1) { fprintf(stderr, "Unknown positional parameter (%d): %s\n", 2, inputs[1]); help = 1; }
+		if (settings.timesFilename == NULL) { fprintf(stderr, "ERROR: Times file not specified.\n"); help = 1; }
+	}
 
 	if (help)
 	{
@@ -146,12 +157,14 @@ int main(int argc, char *argv[])
 		fprintf(stderr, "V1.03\n");
 		fprintf(stderr, "\n");
 		fprintf(stderr, "Usage: omsummary [[-in] <input.csv>] -times <times.csv> [-out <output.csv>] [-scale <scale>] [-scaleprop <scale>] [-header <header>]\n");
+		fprintf(stderr, "       omsummary -batch <input.sleep.csv>... [-scale <scale>] [-scaleprop <scale>] [-header <header>]\n");
 		fprintf(stderr, "\n");
 		fprintf(stderr, "Options:\n");
 		fprintf(stderr, "\n");
 		fprintf(stderr, "\t[-in] <input.csv>       Input file (defaults to stdin)\n");
 		fprintf(stderr, "\t-times <times.csv>      Labelled time spans\n");
 		fprintf(stderr, "\t-out <output.csv>       Output file (defaults to stdout)\n");
+		fprintf(stderr, "\t-batch                  Summarize each input (wildcards allowed) \"*" BATCH_INPUT_SUFFIX "\" with \"*" BATCH_TIMES_SUFFIX "\" to \"*" BATCH_OUTPUT_SUFFIX "\"\n");
 		fprintf(stderr, "\n");
 		fprintf(stderr, "\t-mode:sleep             Use settings for sleep\n");
 		fprintf(stderr, "\n");
@@ -160,14 +173,28 @@ int main(int argc, char *argv[])
 		fprintf(stderr, "\t-countoffset <offset>   Offset to apply to count, e.g. -1\n");
 		fprintf(stderr, "\t-header <header>        Custom output header line\n");
 		fprintf(stderr, "\t-separator <character>  Custom output field separator\n");
+		fprintf(stderr, "\t-threads <count>        Worker threads (default: one per processor)\n");
+		fprintf(stderr, "\t-cache                  Use (or create) a binary cache of the parsed input: <input.csv>.cache\n");
+		fprintf(stderr, "\t-index                  Use (or create) a seek index of the input: <input.csv>.index\n");
+		fprintf(stderr, "\t-pipeline               Read, parse and accumulate the input on separate threads (also for stdin)\n");
+		fprintf(stderr, "\t-sortmemory <MB>        Sort input rows that are not in order, within a memory budget (spilling to temporary files)\n");
+		fprintf(stderr, "\t-stream                 Stream the times, writing each row as soon as the input has passed its interval (times in order)\n");
+		fprintf(stderr, "\t-follow                 Keep reading the input file as it grows (streaming), until interrupted (Ctrl+C)\n");
+		fprintf(stderr, "\t-checkpoint <file>      Resume from (and save) a checkpoint of the results, reading only the input appended since\n");
 		fprintf(stderr, "\n");
 		ret = -1;
 	}
+	else if (batch)
+	{
+		// Run summary for each input
+		ret = (OmSummaryBatch(&settings, positional, inputs) != 0) ? -1 : 0;
+	}
 	else
 	{
 		// Run summary
 		ret = OmSummaryRun(&settings);
 	}
+	free(inputs);
 
 #if defined(_WIN32) && defined(_DEBUG)
 	if (IsDebuggerPresent()) { fprintf(stderr, "\nPress [enter] to exit <%d>....", ret); getc(stdin); }
@@ -0,0 +1,186 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Numeric Parsing
+// Dan Jackson
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <limits.h>
+#include <locale.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "numeric.h"
+
+
+// Skip leading and trailing spaces
+static void NumericTrim(const char **str, size_t *length)
+{
+	while (*length > 0 && (**str == ' ' || **str == '\t')) { (*str)++; (*length)--; }
+	while (*length > 0 && ((*str)[*length - 1] == ' ' || (*str)[*length - 1] == '\t')) { (*length)--; }
+}
+
+
+// Parse with strtod(), using the locale's decimal point
+static bool NumericParseSlow(const char *str, size_t length, double *value)
+{
+	char buffer[64];
+	char *copy = (length < sizeof(buffer)) ? buffer : (char *)malloc(length + 1);
+	if (copy == NULL)
+	{
+		return false;
+	}
+	memcpy(copy, str, length);
+	copy[length] = '\0';
+
+	const char *decimalPoint = localeconv()->decimal_point;
+	if (decimalPoint != NULL && decimalPoint[0] != '\0' && decimalPoint[0] != '.' && decimalPoint[1] == '\0')
+	{
+		char *dot = strchr(copy, '.');
+		if (dot != NULL) { *dot = decimalPoint[0]; }
+	}
+
+	char *end = NULL;
+	*value = strtod(copy, &end);
+	bool valid = (end == copy + length);
+	if (copy != buffer)
+	{
+		free(copy);
+	}
+	return valid;
+}
+
+
+// Parse a decimal number (of the given length, not necessarily NUL-terminated), independent of the locale, returns false if not a number
+bool NumericParseDouble(const char *str, size_t length, double *value)
+{
+	// Exactly representable powers of ten
+	static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	NumericTrim(&str, &length);
+	const char *p = str;
+	const char *end = str + length;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) { negative = (*p == '-'); p++; }
+
+	// Up to 19 significant digits are accumulated exactly
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int significant = 0;
+	int exponent = 0;
+	bool truncated = false;
+	for (; p < end && (unsigned)(*p - '0') <= 9; p++, digits++)
+	{
+		if (significant < 19) { mantissa = mantissa * 10 + (unsigned)(*p - '0'); if (mantissa > 0) { significant++; } }
+		else { exponent++; truncated |= (*p != '0'); }
+	}
+	if (p < end && *p == '.')
+	{
+		for (p++; p < end && (unsigned)(*p - '0') <= 9; p++, digits++)
+		{
+			if (significant < 19) { mantissa = mantissa * 10 + (unsigned)(*p - '0'); exponent--; if (mantissa > 0) { significant++; } }
+			else { truncated |= (*p != '0'); }
+		}
+	}
+	if (digits == 0)
+	{
+		return false;
+	}
+
+	// Optional exponent
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		p++;
+		bool negativeExponent = false;
+		if (p < end && (*p == '-' || *p == '+')) { negativeExponent = (*p == '-'); p++; }
+		if (p >= end) { return false; }
+		int e = 0;
+		for (; p < end && (unsigned)(*p - '0') <= 9; p++)
+		{
+			if (e < 100000) { e = e * 10 + (*p - '0'); }
+		}
+		exponent += negativeExponent ? -e : e;
+	}
+	if (p != end)
+	{
+		return false;
+	}
+
+	// Exact mantissa and power of ten: a single correctly-rounded operation
+	if (!truncated && mantissa <= (UINT64_C(1) << 53) && exponent >= -22 && exponent <= 22)
+	{
+		double result = (double)mantissa;
+		if (exponent < 0) { result /= powers[-exponent]; }
+		else { result *= powers[exponent]; }
+		*value = negative ? -result : result;
+		return true;
+	}
+
+	// Otherwise, the C library (with the locale's decimal point)
+	return NumericParseSlow(str, length, value);
+}
+
+
+// Parse a decimal integer (of the given length, not necessarily NUL-terminated), returns false if not an integer or out of range
+bool NumericParseInt(const char *str, size_t length, int *value)
+{
+	NumericTrim(&str, &length);
+	const char *p = str;
+	const char *end = str + length;
+
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+')) { negative = (*p == '-'); p++; }
+	if (p >= end)
+	{
+		return false;
+	}
+
+	long long result = 0;
+	for (; p < end; p++)
+	{
+		unsigned digit = (unsigned)(*p - '0');
+		if (digit > 9)
+		{
+			return false;
+		}
+		result = result * 10 + digit;
+		if (result > (long long)INT_MAX + 1)
+		{
+			return false;
+		}
+	}
+	if (negative) { result = -result; }
+	if (result > INT_MAX || result < INT_MIN)
+	{
+		return false;
+	}
+	*value = (int)result;
+	return true;
+}
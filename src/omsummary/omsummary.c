@@ -41,53 +41,265 @@
 #include <string.h>
 #include <stdbool.h>
 #include <math.h>
+#include <stdint.h>
+#include <signal.h>
 
 #include "omsummary.h"
 #include "timestamp.h"
 #include "csvload.h"
+#include "numeric.h"
+#include "output.h"
+#include "thread.h"
+#include "cache.h"
+#include "sort.h"
+#include "follow.h"
+#include "ring.h"
+#include "stream.h"
 
+// Rows formatted by each output thread at a time
+#define OMSUMMARY_OUTPUT_ROWS 16384
 
+// Default header line
+#define OMSUMMARY_HEADER "Label,Start,End,Interval,First,TimeUntilFirst,Last,TimeAfterLast,FirstToLast,Count,Duration,FirstToLastMinusDuration,Proportion"
 
-typedef struct
-{
-	char label[256];	// label for this interval
+// Written intervals held before discarding them, when streaming
+#define OMSUMMARY_STREAM_DISCARD 4096
+
+// Bytes of the data file parsed by each parsing thread at a time, and the rows first read to detect the time formats
+#define OMSUMMARY_PARSE_CHUNK (4 * 1024 * 1024)
+#define OMSUMMARY_PARSE_PROBE_ROWS 16
+
+// Events in each batch passed from the parse thread to the accumulating thread, and the number of batches in flight
+#define OMSUMMARY_PIPELINE_BATCH 4096
+#define OMSUMMARY_PIPELINE_BATCHES 8
 
-	double start;		// start of this interval
-	double end;			// end of this interval
+// Extensions of the cache and seek index sidecars of a data file
+#define OMSUMMARY_CACHE_EXTENSION ".cache"
+#define OMSUMMARY_INDEX_EXTENSION ".index"
 
-	double first;		// earliest timestamp found within this interval
-	double last;		// latest timestamp found within this interval
-	double duration;	// sum of all time span durations intersecting this interval
-	int count;			// count of all time spans overlapping this interval
-} interval_t;
 
+
+// Intervals held as parallel arrays of the fields used by the sweep, with the labels stored once in an arena
 typedef struct
 {
 	int numIntervals;
-	interval_t *intervals;
+	int capacityIntervals;
+
+	timestamp_t *start;		// start of each interval
+	timestamp_t *end;		// end of each interval
+
+	timestamp_t *first;		// earliest timestamp found within each interval (when count > 0)
+	timestamp_t *last;		// latest timestamp found within each interval (when count > 0)
+	timestamp_t *duration;	// sum of all time span durations intersecting each interval
+	int *count;				// count of all time spans overlapping each interval
+
+	size_t *labelOffset;	// offset of each interval's label in the label arena
+	int *labelLength;		// length of each interval's label
+
+	char *labels;			// label arena (each label is NUL-terminated)
+	size_t labelsLength;
+	size_t labelsCapacity;
+
+	int *order;				// intervals in order of start (only when the intervals overlap, or are not in order)
+	timestamp_t *maxEnd;	// implicit tree of the latest end of the intervals under each node (node 1 is the root, the leaves follow the order)
+	int treeLeaves;			// number of leaves of the tree (a power of two)
 } times_t;
 
-int TimesLoad(times_t *times, const char *filename)
+
+// Free the intervals
+static void TimesFree(times_t *times)
+{
+	free(times->start);
+	free(times->end);
+	free(times->first);
+	free(times->last);
+	free(times->duration);
+	free(times->count);
+	free(times->labelOffset);
+	free(times->labelLength);
+	free(times->labels);
+	free(times->order);
+	free(times->maxEnd);
+	memset(times, 0, sizeof(times_t));
+}
+
+
+// Add an interval, returns false if out of memory
+static bool TimesAdd(times_t *times, const char *label, int labelLength, timestamp_t start, timestamp_t end)
+{
+	// Need more capacity?
+	if (times->numIntervals + 1 > times->capacityIntervals)
+	{
+		int capacity = 15 * times->capacityIntervals / 10 + 1;	// Grow by ~1.5x
+		void *p;
+		if ((p = realloc(times->start, capacity * sizeof(timestamp_t))) == NULL) { return false; } times->start = (timestamp_t *)p;
+		if ((p = realloc(times->end, capacity * sizeof(timestamp_t))) == NULL) { return false; } times->end = (timestamp_t *)p;
+		if ((p = realloc(times->first, capacity * sizeof(timestamp_t))) == NULL) { return false; } times->first = (timestamp_t *)p;
+		if ((p = realloc(times->last, capacity * sizeof(timestamp_t))) == NULL) { return false; } times->last = (timestamp_t *)p;
+		if ((p = realloc(times->duration, capacity * sizeof(timestamp_t))) == NULL) { return false; } times->duration = (timestamp_t *)p;
+		if ((p = realloc(times->count, capacity * sizeof(int))) == NULL) { return false; } times->count = (int *)p;
+		if ((p = realloc(times->labelOffset, capacity * sizeof(size_t))) == NULL) { return false; } times->labelOffset = (size_t *)p;
+		if ((p = realloc(times->labelLength, capacity * sizeof(int))) == NULL) { return false; } times->labelLength = (int *)p;
+		times->capacityIntervals = capacity;
+	}
+
+	// Bump-allocate the label in the arena
+	if (times->labelsLength + labelLength + 1 > times->labelsCapacity)
+	{
+		size_t capacity = 2 * times->labelsCapacity;
+		if (capacity < times->labelsLength + labelLength + 1) { capacity = times->labelsLength + labelLength + 1 + 4096; }
+		char *labels = (char *)realloc(times->labels, capacity);
+		if (labels == NULL) { return false; }
+		times->labels = labels;
+		times->labelsCapacity = capacity;
+	}
+	memcpy(times->labels + times->labelsLength, label, labelLength);
+	times->labels[times->labelsLength + labelLength] = '\0';
+
+	int i = times->numIntervals;
+	times->start[i] = start;
+	times->end[i] = end;
+	times->first[i] = 0;
+	times->last[i] = 0;
+	times->duration[i] = 0;
+	times->count[i] = 0;
+	times->labelOffset[i] = times->labelsLength;
+	times->labelLength[i] = labelLength;
+	times->labelsLength += labelLength + 1;
+	times->numIntervals++;
+	return true;
+}
+
+
+// Discard the first intervals (once they have been written)
+static void TimesDiscard(times_t *times, int count)
+{
+	int remaining = times->numIntervals - count;
+	size_t labelsStart = (remaining > 0) ? times->labelOffset[count] : times->labelsLength;
+	memmove(times->start, times->start + count, remaining * sizeof(timestamp_t));
+	memmove(times->end, times->end + count, remaining * sizeof(timestamp_t));
+	memmove(times->first, times->first + count, remaining * sizeof(timestamp_t));
+	memmove(times->last, times->last + count, remaining * sizeof(timestamp_t));
+	memmove(times->duration, times->duration + count, remaining * sizeof(timestamp_t));
+	memmove(times->count, times->count + count, remaining * sizeof(int));
+	memmove(times->labelLength, times->labelLength + count, remaining * sizeof(int));
+	for (int i = 0; i < remaining; i++)
+	{
+		times->labelOffset[i] = times->labelOffset[i + count] - labelsStart;
+	}
+	memmove(times->labels, times->labels + labelsStart, times->labelsLength - labelsStart);
+	times->labelsLength -= labelsStart;
+	times->numIntervals = remaining;
+}
+
+
+// An interval's start and position, for sorting
+typedef struct
+{
+	timestamp_t start;
+	int index;
+} times_order_t;
+
+
+// Compare intervals by start, then by position
+static int TimesOrderCompare(const void *a, const void *b)
+{
+	const times_order_t *ta = (const times_order_t *)a;
+	const times_order_t *tb = (const times_order_t *)b;
+	if (ta->start != tb->start) { return (ta->start < tb->start) ? -1 : 1; }
+	return ta->index - tb->index;
+}
+
+
+// Build the interval tree (for overlapping intervals): the intervals in order of start, and the latest end under each node, returns false if out of memory
+static bool TimesIndex(times_t *times)
+{
+	int leaves = 1;
+	while (leaves < times->numIntervals) { leaves <<= 1; }
+	times_order_t *sorted = (times_order_t *)malloc(times->numIntervals * sizeof(times_order_t));
+	times->order = (int *)malloc(times->numIntervals * sizeof(int));
+	times->maxEnd = (timestamp_t *)malloc(2 * leaves * sizeof(timestamp_t));
+	if (sorted == NULL || times->order == NULL || times->maxEnd == NULL)
+	{
+		free(sorted);
+		free(times->order);
+		free(times->maxEnd);
+		times->order = NULL;
+		times->maxEnd = NULL;
+		return false;
+	}
+
+	for (int i = 0; i < times->numIntervals; i++)
+	{
+		sorted[i].start = times->start[i];
+		sorted[i].index = i;
+	}
+	qsort(sorted, times->numIntervals, sizeof(times_order_t), TimesOrderCompare);
+
+	times->treeLeaves = leaves;
+	for (int i = 0; i < leaves; i++)
+	{
+		if (i < times->numIntervals)
+		{
+			times->order[i] = sorted[i].index;
+			times->maxEnd[leaves + i] = times->end[sorted[i].index];
+		}
+		else
+		{
+			times->maxEnd[leaves + i] = INT64_MIN;
+		}
+	}
+	for (int node = leaves - 1; node >= 1; node--)
+	{
+		timestamp_t left = times->maxEnd[2 * node], right = times->maxEnd[2 * node + 1];
+		times->maxEnd[node] = (left > right) ? left : right;
+	}
+	free(sorted);
+	return true;
+}
+
+
+// Parse a CSV token as a time (each column has its own parser)
+static timestamp_t TokenTime(csv_load_t *csv, int index, time_parser_t *parser)
+{
+	int length;
+	const char *token = CsvTokenSpan(csv, index, &length);
+	return TimeParserParse(parser, token, (size_t)length);
+}
+
+
+// Reads the intervals of a times file, a row at a time
+typedef struct
 {
 	csv_load_t csv;
-	int colStart = -1, colEnd = -1, colLabel = -1;
-	int err = 0;
+	int colStart, colEnd, colLabel;
+	time_parser_t startParser, endParser;
+	timestamp_t lastEnd;			// Latest end of the intervals read
+	bool overlapping;				// An interval started before a preceeding interval ended
+	int err;						// Number of errors
+} times_reader_t;
 
-	// Zero return
-	memset(times, 0, sizeof(times_t));
 
-	int headerCells = CsvOpen(&csv, filename, CSV_HEADER_DETECT_NON_NUMERIC, CSV_SEPARATORS);
+// Open a times file and read its header, returns false if the required columns are missing
+static bool TimesOpen(times_reader_t *reader, const char *filename)
+{
+	memset(reader, 0, sizeof(times_reader_t));
+	reader->colStart = -1;
+	reader->colEnd = -1;
+	reader->colLabel = -1;
+
+	int headerCells = CsvOpen(&reader->csv, filename, CSV_HEADER_DETECT_NON_NUMERIC, CSV_SEPARATORS);
 	if (headerCells > 0)
 	{
 		// TODO: Parse header cells
 		int i;
 		for (i = 0; i < headerCells; i++)
 		{
-			const char *heading = CsvTokenString(&csv, i);
+			const char *heading = CsvTokenString(&reader->csv, i);
 			//fprintf(stderr, "HEADER %d: %s\n", i + 1, heading);
-			if (!_strcasecmp(heading, "Start")) { colStart = i; }
-			else if (!_strcasecmp(heading, "End")) { colEnd = i; }
-			else if (!_strcasecmp(heading, "Label")) { colLabel = i; }
+			if (!_strcasecmp(heading, "Start")) { reader->colStart = i; }
+			else if (!_strcasecmp(heading, "End")) { reader->colEnd = i; }
+			else if (!_strcasecmp(heading, "Label")) { reader->colLabel = i; }
 			else
 			{
 				fprintf(stderr, "WARNING: Unknown column %d heading: '%s'.\n", i + 1, heading);
@@ -95,343 +307,1849 @@ int TimesLoad(times_t *times, const char *filename)
 		}
 	}
 
-	if (colStart < 0 && colEnd < 0 && colLabel < 0)
+	if (reader->colStart < 0 && reader->colEnd < 0 && reader->colLabel < 0)
 	{
 		fprintf(stderr, "WARNING: No recognized heading line -- default columns will be used.\n");
-		colStart = 0;
-		colEnd = 1;
-		colLabel = 2;
+		reader->colStart = 0;
+		reader->colEnd = 1;
+		reader->colLabel = 2;
 	}
 
-	if (colStart < 0 || colEnd < 0)
+	if (reader->colStart < 0 || reader->colEnd < 0)
 	{
 		fprintf(stderr, "ERROR: One or more required columns ('start', 'end') are missing.\n");
-		return -1;
+		CsvClose(&reader->csv);
+		return false;
 	}
 
-	interval_t *intervals = NULL;
-	int capacityIntervals = 0;
+	// Only tokenize the required columns
+	CsvProjectColumn(&reader->csv, reader->colStart);
+	CsvProjectColumn(&reader->csv, reader->colEnd);
+	CsvProjectColumn(&reader->csv, reader->colLabel);
 
-	double lastEnd = 0;
+	TimeParserInit(&reader->startParser);
+	TimeParserInit(&reader->endParser);
+	return true;
+}
+
+
+// Read the next interval of a times file and add it to the intervals, returns false at the end of the file (or if out of memory)
+static bool TimesRead(times_reader_t *reader, times_t *times)
+{
+	csv_load_t *csv = &reader->csv;
 	int tokens;
-	int numIntervals = 0;
-	interval_t newInterval = { 0 };
-	while ((tokens = CsvReadLine(&csv)) >= 0)
+	while ((tokens = CsvReadLine(csv)) >= 0)
 	{
-		if (tokens > colStart && tokens > colEnd)
+		if (tokens > reader->colStart && tokens > reader->colEnd)
 		{
-			if (colLabel >= 0 && tokens > colLabel)
+			const char *label = NULL;
+			int labelLength = 0;
+			if (reader->colLabel >= 0 && tokens > reader->colLabel)
 			{
 				// Use the label
-				strcpy(newInterval.label, CsvTokenString(&csv, colLabel));
+				label = CsvTokenSpan(csv, reader->colLabel, &labelLength);
 			}
-			else 
+			if (labelLength <= 0)
 			{
-				// Use the start as the label
-				strcpy(newInterval.label, CsvTokenString(&csv, colStart));
+				// Use the start as the label (when no label, or an empty one)
+				label = CsvTokenSpan(csv, reader->colStart, &labelLength);
 			}
-			newInterval.start = TimeParse(CsvTokenString(&csv, colStart));
-			newInterval.end = TimeParse(CsvTokenString(&csv, colEnd));
+			timestamp_t start = TokenTime(csv, reader->colStart, &reader->startParser);
+			timestamp_t end = TokenTime(csv, reader->colEnd, &reader->endParser);
 
-			if (newInterval.end < newInterval.start)
+			if (end < start)
 			{
-				fprintf(stderr, "ERROR: Line %d has a negative interval (end before start).\n", CsvLineNumber(&csv));
-				err++;
+				fprintf(stderr, "ERROR: Line %d has a negative interval (end before start).\n", CsvLineNumber(csv));
+				reader->err++;
 			}
-			if (newInterval.start < lastEnd)
+			if (start < reader->lastEnd)
 			{
-				fprintf(stderr, "ERROR: Line %d has an interval that starts before a preceeding interval ends.\n", CsvLineNumber(&csv));
-				err++;
+				reader->overlapping = true;
 			}
-			if (newInterval.end > lastEnd)
+			if (end > reader->lastEnd)
 			{
-				lastEnd = newInterval.end;
+				reader->lastEnd = end;
 			}
 
 			// Add interval
-			// Need more capacity?
-			if (numIntervals + 1 > capacityIntervals)
+			if (!TimesAdd(times, label, labelLength, start, end))
 			{
-				capacityIntervals = 15 * capacityIntervals / 10 + 1;	// Grow by ~1.5x
-				intervals = (interval_t *)realloc(intervals, capacityIntervals * sizeof(interval_t));
+				fprintf(stderr, "ERROR: Out of memory adding the interval on line %d.\n", CsvLineNumber(csv));
+				reader->err++;
+				return false;
 			}
-			intervals[numIntervals] = newInterval;
-			numIntervals++;
+			return true;
 		}
 		else if (tokens > 0)	// Ignore completely blank lines
 		{
-			fprintf(stderr, "WARNING: Too-few columns, ignoring row on line %d.\n", CsvLineNumber(&csv));
+			fprintf(stderr, "WARNING: Too-few columns, ignoring row on line %d.\n", CsvLineNumber(csv));
 		}
 	}
+	return false;
+}
 
-	// Set return
-	times->intervals = intervals;
-	times->numIntervals = numIntervals;
 
-	return err;
+// Close a times file
+static void TimesClose(times_reader_t *reader)
+{
+	CsvClose(&reader->csv);
 }
 
 
-int OmSummaryRun(omsummary_settings_t *settings)
+
+// Append a time to the output
+static void OutputTime(output_t *output, time_formatter_t *formatter, timestamp_t t)
 {
-	// Load times
-	fprintf(stderr, "Opening times: %s\n", settings->timesFilename);
-	times_t times;
-	if (TimesLoad(&times, settings->timesFilename) != 0)
+	char *p = OutputReserve(output, TIME_MAX_STRING);
+	if (p != NULL)
 	{
-		fprintf(stderr, "ERROR: There was a problem with the times data: %s\n", settings->timesFilename);
+		output->length += TimeFormat(formatter, t, p);
 	}
+}
 
-	// 
 
-	// Load data
-	csv_load_t csv;
-	int colStart = -1, colEnd = -1, colDuration = -1;
-	if (settings->filename != NULL && settings->filename[0] != '\0')
+// Append the summary row for an interval to the output
+static void SummaryWriteRow(output_t *output, time_formatter_t *formatter, omsummary_settings_t *settings, const char *separator, times_t *times, int index)
+{
+	size_t separatorLength = strlen(separator);
+	timestamp_t start = times->start[index];
+	timestamp_t end = times->end[index];
+	timestamp_t first = times->first[index];
+	timestamp_t last = times->last[index];
+	timestamp_t duration = times->duration[index];
+	int count = times->count[index];
+	timestamp_t interval = end - start;
+	double proportion = 0;
+	if (interval > 0)
 	{
-		fprintf(stderr, "Opening data: %s\n", settings->filename);
+		proportion = (double)duration / (double)interval;
 	}
-	int headerCells = CsvOpen(&csv, settings->filename, CSV_HEADER_DETECT_NON_NUMERIC, CSV_SEPARATORS);
-	if (headerCells > 0)
-	{
-		// Parse header cells
-		int i;
-		for (i = 0; i < headerCells; i++)
-		{
-			const char *heading = CsvTokenString(&csv, i);
 
-			if (!_strcasecmp(heading, "Start")) { colStart = i; }
-			else if (!_strcasecmp(heading, "End")) { colEnd = i; }
-			else if (!_strcasecmp(heading, "Duration(s)")) { colDuration = i; }
-			else
-			{
-				fprintf(stderr, "WARNING: Unknown data column %d heading: '%s'.\n", i + 1, heading);
-			}
-		}
-	}
+	OutputWrite(output, times->labels + times->labelOffset[index], times->labelLength[index]);	// Label
+	OutputWrite(output, separator, separatorLength);
+	OutputTime(output, formatter, start);											// Start
+	OutputWrite(output, separator, separatorLength);
+	OutputTime(output, formatter, end);												// End
+	OutputWrite(output, separator, separatorLength);
+	OutputFixed(output, TimeTicksToSeconds(interval) * settings->scale, 6);				// Interval
+	OutputWrite(output, separator, separatorLength);
 
-	if (colStart < 0 && colEnd < 0 && colDuration < 0)
+	if (count > 0)
 	{
-		fprintf(stderr, "WARNING: No recognized data heading line -- default columns will be used.\n");
-		colStart = 0;
-		colEnd = 1;
-		colDuration = 2;
+		OutputTime(output, formatter, first);										// First
+		OutputWrite(output, separator, separatorLength);
+		OutputFixed(output, TimeTicksToSeconds(first - start) * settings->scale, 6);	// TimeUntilFirst
 	}
-
-	if (colStart < 0)
+	else
 	{
-		fprintf(stderr, "ERROR: One or more required data columns ('start') is missing.\n");
+		OutputWrite(output, separator, separatorLength);
 	}
+	OutputWrite(output, separator, separatorLength);
 
-
-	int currentTime = 0;
-	int tokens;
-	while ((tokens = CsvReadLine(&csv)) >= 0)
+	if (count > 0)
 	{
-		if (tokens > colStart)
-		{
-			// Event time
-			double start = TimeParse(CsvTokenString(&csv, colStart));
-
-			// Default to an instantaneous event if no end
-			double end = start;
-			double duration = 0;
-
-			// When given end time
-			if (colEnd >= 0 && tokens > colEnd)
-			{
-				end = TimeParse(CsvTokenString(&csv, colEnd));
-				duration = end - start;
-			}
-
-			// When given a specific duration, use that
-			if (colDuration >= 0 && tokens > colDuration)
-			{
-				duration = CsvTokenFloat(&csv, colDuration);
-				if (end != start && fabs(duration - (end - start)) > 0.01)
-				{
-					fprintf(stderr, "WARNING: Duration does not match (end - start) on data line %d.", CsvLineNumber(&csv));
-				}
-			}
-
-//fprintf(stderr, "@%s, %f\n", TimeString(start, NULL), duration);
+		OutputTime(output, formatter, last);										// Last
+		OutputWrite(output, separator, separatorLength);
+		OutputFixed(output, TimeTicksToSeconds(end - last) * settings->scale, 6);	// TimeAfterLast
+	}
+	else
+	{
+		OutputWrite(output, separator, separatorLength);
+	}
+	OutputWrite(output, separator, separatorLength);
 
-			// If we have any periods left
-			while (currentTime < times.numIntervals)
-			{
-				interval_t *it = &times.intervals[currentTime];
-				double localStart = start;
-				double localEnd = end;
+	if (count > 0)
+	{
+		OutputFixed(output, TimeTicksToSeconds(last - first) * settings->scale, 6);	// FirstToLast
+	}
+	OutputWrite(output, separator, separatorLength);
 
-				// If start before this, advance to it
-				if (localStart < it->start)
-				{
-					localStart = it->start;
-				}
+	OutputInt(output, count + settings->countOffset);								// Count
+	OutputWrite(output, separator, separatorLength);
+	OutputFixed(output, TimeTicksToSeconds(duration) * settings->scale, 6);			// Duration
+	OutputWrite(output, separator, separatorLength);
 
-				// If start before this, advance to it
-				if (localEnd > it->end)
-				{
-					localEnd = it->end;
-				}
+	if (count > 0)
+	{
+		OutputFixed(output, TimeTicksToSeconds((last - first) - duration) * settings->scale, 6);	// FirstToLastMinusDuration
+	}
+	OutputWrite(output, separator, separatorLength);
 
-				// Interval
-				double localDuration = localEnd - localStart;
+	OutputFixed(output, proportion * settings->scaleProp, 6);							// Proportion
+	OutputWrite(output, "\n", 1);
+}
 
-//fprintf(stderr, "checking interval %d\n", currentTime);
 
-				// If an interval remains
-				if (localDuration >= 0.0)
-				{
+// A range of rows formatted by an output thread
+typedef struct
+{
+	omsummary_settings_t *settings;
+	const char *separator;
+	times_t *times;
+	int first;
+	int count;
+	output_t output;			// Memory-only buffer, reused for each range
+	thread_t thread;
+} summary_output_task_t;
+
+
+// Output thread: format a range of rows in to its own buffer
+static void *SummaryOutputThread(void *arg)
+{
+	summary_output_task_t *task = (summary_output_task_t *)arg;
+	time_formatter_t formatter;
+	TimeFormatterInit(&formatter);
+	for (int i = task->first; i < task->first + task->count; i++)
+	{
+		SummaryWriteRow(&task->output, &formatter, task->settings, task->separator, task->times, i);
+	}
+	return NULL;
+}
 
-//fprintf(stderr, "within interval %d ", currentTime);
-//fprintf(stderr, "(%s - ", TimeString(it->start, NULL)); 
-//fprintf(stderr, "%s)", TimeString(it->end, NULL));
-//fprintf(stderr, ": %f\n", localDuration);
 
-					if (it->count <= 0)
-					{
-						it->first = localStart;
-					}
-					it->last = localEnd;
-					it->duration += localDuration;
-					it->count++;
-				}
+// Write the summary rows, formatting ranges of rows on several threads and writing their buffers in order, returns false if there was an error
+static bool SummaryWriteRowsParallel(output_t *output, omsummary_settings_t *settings, const char *separator, times_t *times, int numThreads)
+{
+	bool ok = OutputFlush(output);
+	summary_output_task_t *tasks = (summary_output_task_t *)calloc(numThreads, sizeof(summary_output_task_t));
+	output_t *buffers = (output_t *)calloc(numThreads, sizeof(output_t));
+	if (tasks == NULL || buffers == NULL)
+	{
+		free(tasks);
+		free(buffers);
+		return false;
+	}
 
-				// Time to check the next period
-				if (end >= it->end)
-				{
-					currentTime++; 
-					continue;
-				}
+	for (int t = 0; t < numThreads; t++)
+	{
+		tasks[t].settings = settings;
+		tasks[t].separator = separator;
+		tasks[t].times = times;
+		OutputInit(&tasks[t].output, NULL);
+	}
 
-				break;
+	// Each round formats up to OMSUMMARY_OUTPUT_ROWS per thread, bounding the memory used
+	int numIntervals = times->numIntervals;
+	for (int first = 0; first < numIntervals; first += numThreads * OMSUMMARY_OUTPUT_ROWS)
+	{
+		int started = 0;
+		for (int t = 0; t < numThreads; t++)
+		{
+			summary_output_task_t *task = &tasks[t];
+			task->first = first + t * OMSUMMARY_OUTPUT_ROWS;
+			task->count = numIntervals - task->first;
+			if (task->count > OMSUMMARY_OUTPUT_ROWS) { task->count = OMSUMMARY_OUTPUT_ROWS; }
+			if (task->count <= 0) { break; }
+
+			// The first range is formatted on this thread once the others are started (as is any range whose thread cannot be started)
+			task->thread.function = NULL;
+			if (t > 0 && !ThreadCreate(&task->thread, SummaryOutputThread, task))
+			{
+				SummaryOutputThread(task);
+				task->thread.function = NULL;
 			}
-
-
+			started++;
 		}
-		else if (tokens > 0)	// Ignore completely blank lines
+		if (started > 0)
+		{
+			SummaryOutputThread(&tasks[0]);
+		}
+		for (int t = 0; t < started; t++)
+		{
+			if (tasks[t].thread.function != NULL)
+			{
+				ThreadJoin(&tasks[t].thread);
+			}
+			buffers[t] = tasks[t].output;
+		}
+		if (!OutputWriteBuffers(output, buffers, started))
 		{
-			fprintf(stderr, "WARNING: Too-few columns, ignoring row on line %d.\n", CsvLineNumber(&csv));
+			ok = false;
+		}
+		for (int t = 0; t < started; t++)
+		{
+			tasks[t].output.length = 0;
 		}
 	}
 
+	for (int t = 0; t < numThreads; t++)
+	{
+		OutputClose(&tasks[t].output);
+	}
+	free(tasks);
+	free(buffers);
+	return ok;
+}
 
-	// Output data
-	FILE *ofp;
 
-	if (settings->outFilename == NULL || settings->outFilename[0] == '\0')
+// Write the rows of all of the intervals, returns false if there was an error
+static bool SummaryWriteRows(output_t *output, omsummary_settings_t *settings, const char *separator, times_t *times)
+{
+	int numThreads = (settings->threads > 0) ? settings->threads : ThreadProcessorCount();
+	if (numThreads > 1 && times->numIntervals > OMSUMMARY_OUTPUT_ROWS)
 	{
-		ofp = stdout;
+		// Large outputs are formatted in parallel
+		return SummaryWriteRowsParallel(output, settings, separator, times, numThreads);
 	}
-	else
+
+	time_formatter_t formatter;
+	TimeFormatterInit(&formatter);
+	for (int j = 0; j < times->numIntervals; j++)
 	{
-		fprintf(stderr, "Saving data: %s\n", settings->outFilename);
-		ofp = fopen(settings->outFilename, "wt");
+		SummaryWriteRow(output, &formatter, settings, separator, times, j);
 	}
+	return true;
+}
 
-	if (ofp == NULL)
+
+// Write the header line (with the custom separator), unless the header is empty
+static void SummaryWriteHeader(output_t *output, omsummary_settings_t *settings, const char *separator)
+{
+	const char *header = (settings->header != NULL) ? settings->header : OMSUMMARY_HEADER;
+	if (header[0] == '\0')
 	{
-		fprintf(stderr, "ERROR: Problem opening CSV file for output: %s\n", settings->outFilename);
-		return -1;
+		return;
 	}
-
-	// Write header (with custom separator)
-	const char *header = "Label,Start,End,Interval,First,TimeUntilFirst,Last,TimeAfterLast,FirstToLast,Count,Duration,FirstToLastMinusDuration,Proportion";
-	const char *separator = ",";
-	if (settings->header != NULL)
+	for (const char *p = header; ; p++)
 	{
-		header = settings->header;
+		const char *comma = strchr(p, ',');
+		if (comma == NULL)
+		{
+			OutputString(output, p);
+			break;
+		}
+		OutputWrite(output, p, comma - p);
+		OutputString(output, separator);
+		p = comma;
 	}
-	if (settings->separator != NULL)
+	OutputWrite(output, "\n", 1);
+}
+
+
+// Filename of a sidecar file of a data file (to be freed by the caller)
+static char *SummarySidecarFilename(const char *filename, const char *extension)
+{
+	char *sidecarFilename = (char *)malloc(strlen(filename) + strlen(extension) + 1);
+	if (sidecarFilename != NULL)
 	{
-		separator = settings->separator;
+		strcpy(sidecarFilename, filename);
+		strcat(sidecarFilename, extension);
 	}
-	if (header != NULL && header[0] != '\0')
+	return sidecarFilename;
+}
+
+
+// Find the first interval that ends at or after the given time (binary search of the sorted intervals)
+static int SummaryFindInterval(times_t *times, timestamp_t time)
+{
+	int low = 0, high = times->numIntervals;
+	while (low < high)
 	{
-		for (const char *p = header; *p != '\0'; p++)
+		int mid = low + (high - low) / 2;
+		if (times->end[mid] >= time)
 		{
-			if (*p == ',')
-			{
-				fprintf(ofp, "%s", separator);
-			}
-			else
-			{
-				fprintf(ofp, "%c", *p);
-			}
+			high = mid;
+		}
+		else
+		{
+			low = mid + 1;
 		}
-		fprintf(ofp, "\n");
+	}
+	return low;
+}
+
+
+// Accumulate an event in to an interval, if they overlap (an event in order starting as the interval ends is counted, with no duration)
+static void SummaryCreditInterval(times_t *times, int index, timestamp_t start, timestamp_t end, bool ordered)
+{
+	timestamp_t intervalEnd = times->end[index];
+	timestamp_t localStart = start;
+	timestamp_t localEnd = end;
+
+	// If start before this, advance to it
+	if (localStart < times->start[index])
+	{
+		localStart = times->start[index];
 	}
 
-	int j = 0;
-	for (j = 0; j < times.numIntervals; j++)
+	// If start before this, advance to it
+	if (localEnd > intervalEnd)
 	{
-		interval_t *it = &times.intervals[j];
-		double interval = it->end - it->start;
-		double proportion = 0;
-		if (interval > 0)
-		{
-			proportion = it->duration / interval;
-		}
+		localEnd = intervalEnd;
+	}
 
-		fprintf(ofp, "%s%s", it->label, separator);										// Label
-		fprintf(ofp, "%s%s", TimeString(it->start, NULL), separator);					// Start
-		fprintf(ofp, "%s%s", TimeString(it->end, NULL), separator);						// End
-		fprintf(ofp, "%f%s", interval * settings->scale, separator);					// Interval
+	// Interval
+	timestamp_t localDuration = localEnd - localStart;
 
-		if (it->first <= 0)
+	// If an interval remains (out of order, an event starting as a non-empty interval ends does not count, whatever the order of events)
+	if (localDuration >= 0 && (ordered || start < intervalEnd || start <= times->start[index]))
+	{
+		if (times->count[index] <= 0 || localStart < times->first[index])
 		{
-			fprintf(ofp, "%s%s", separator, separator);
+			times->first[index] = localStart;
 		}
-		else
+		if (times->count[index] <= 0 || localEnd > times->last[index])
 		{
-			fprintf(ofp, "%s%s", TimeString(it->first, NULL), separator);				// First
-			fprintf(ofp, "%f%s", (it->first - it->start) * settings->scale, separator); // TimeUntilFirst
+			times->last[index] = localEnd;
 		}
+		times->duration[index] += localDuration;
+		times->count[index]++;
+	}
+}
 
-		if (it->last <= 0)
+
+// Accumulate an event in to every overlapping interval found using the interval tree (visiting only the branches that hold an overlapping interval)
+static void SummaryAddEventIndexed(times_t *times, timestamp_t start, timestamp_t end)
+{
+	// Only the intervals starting no later than the event ends can overlap
+	int low = 0, high = times->numIntervals;
+	while (low < high)
+	{
+		int mid = low + (high - low) / 2;
+		if (times->start[times->order[mid]] <= end)
 		{
-			fprintf(ofp, "%s%s", separator, separator);
+			low = mid + 1;
 		}
 		else
 		{
-			fprintf(ofp, "%s%s", TimeString(it->last, NULL), separator);				// Last
-			fprintf(ofp, "%f%s", (it->end - it->last) * settings->scale, separator);	// TimeAfterLast
+			high = mid;
 		}
+	}
+	int limit = low;
 
-		if (it->first <= 0 || it->last <= 0)
+	// Of those, descend in to the nodes with an interval ending no earlier than the event starts
+	int stack[2 * 32];
+	int depth = 0;
+	stack[depth++] = 1;
+	while (depth > 0)
+	{
+		int node = stack[--depth];
+		if (times->maxEnd[node] < start)
 		{
-			fprintf(ofp, "%s", separator);
+			continue;
 		}
-		else
+
+		// First leaf under the node
+		int level = 0;
+		while ((node >> level) > 1) { level++; }
+		int first = (node - (1 << level)) * (times->treeLeaves >> level);
+		if (first >= limit)
 		{
-			fprintf(ofp, "%f%s", (it->last - it->first) * settings->scale, separator);	// FirstToLast
+			continue;
 		}
 
-		fprintf(ofp, "%d%s", it->count + settings->countOffset, separator);				// Count
-		fprintf(ofp, "%f%s", it->duration * settings->scale, separator);				// Duration
-
-		if (it->first <= 0 || it->last <= 0)
+		if (node >= times->treeLeaves)
 		{
-			fprintf(ofp, "%s", separator);
+			SummaryCreditInterval(times, times->order[node - times->treeLeaves], start, end, false);
 		}
 		else
 		{
-			fprintf(ofp, "%f%s", ((it->last - it->first) - it->duration) * settings->scale, separator);	// FirstToLastMinusDuration
+			stack[depth++] = 2 * node + 1;
+			stack[depth++] = 2 * node;
 		}
+	}
+}
 
-		fprintf(ofp, "%f", proportion * settings->scaleProp);							// Proportion
 
-		fprintf(ofp, "\n");
+// Accumulate an event in to the intervals, the cursor is the first interval not yet ended by an earlier event
+static void SummaryAddEvent(times_t *times, int *cursor, timestamp_t start, timestamp_t end)
+{
+	// Overlapping (or unordered) intervals are found with the interval tree, and the cursor is not used
+	if (times->order != NULL)
+	{
+		SummaryAddEventIndexed(times, start, end);
+		return;
+	}
+
+	int current = *cursor;
 
+	// An event starting before the end of an interval the cursor has passed is out of order: search for its first interval
+	bool ordered = (current <= 0 || times->end[current - 1] < start);
+	if (!ordered)
+	{
+		current = SummaryFindInterval(times, start);
 	}
 
-	if (ofp != stdout)
+	// If we have any periods left
+	while (current < times->numIntervals)
 	{
-		fclose(ofp);
+		SummaryCreditInterval(times, current, start, end, ordered);
+
+		// Time to check the next period
+		if (end >= times->end[current])
+		{
+			current++;
+			continue;
+		}
+
+		break;
 	}
-	//ofp = NULL;
 
-	return 0;
+	// An out-of-order event only moves the cursor forward
+	if (ordered || current > *cursor)
+	{
+		*cursor = current;
+	}
+}
+
+
+// The sweep of the events in to the intervals
+typedef struct
+{
+	times_t *times;
+	int cursor;				// First interval not yet ended by an earlier event
+	size_t sortMemory;		// Memory budget for sorting the events from the first found out of order (0 to accumulate them directly)
+	timestamp_t lastStart;	// Latest start of the events accumulated directly
+	bool sorting;			// Events are being added to the sort
+	bool sorted;			// There is a sort to finish
+	event_sort_t sort;
+
+	// Streaming: the intervals are read as the events reach them, and each is written (then discarded) once the events have passed it
+	times_reader_t *timesReader;	// Times file being read (NULL when the intervals are all loaded)
+	bool timesEnded;		// The whole times file has been read
+	int written;			// Intervals at the front that have been written
+	timestamp_t writtenEnd;	// End of the last interval written
+	int lateEvents;			// Events too late for intervals already written
+	output_t *output;
+	time_formatter_t formatter;
+	omsummary_settings_t *settings;
+	const char *separator;
+} summary_sweep_t;
+
+
+// Start a sweep of the events in to the intervals
+static void SummarySweepInit(summary_sweep_t *sweep, times_t *times, size_t sortMemory)
+{
+	memset(sweep, 0, sizeof(summary_sweep_t));
+	sweep->times = times;
+	sweep->sortMemory = sortMemory;
+	sweep->lastStart = INT64_MIN;
 }
 
+
+// Stream the intervals: read them as the events reach them, and write each once the events have passed it
+static void SummarySweepStream(summary_sweep_t *sweep, times_reader_t *timesReader, output_t *output, omsummary_settings_t *settings, const char *separator)
+{
+	sweep->timesReader = timesReader;
+	sweep->writtenEnd = INT64_MIN;
+	sweep->output = output;
+	TimeFormatterInit(&sweep->formatter);
+	sweep->settings = settings;
+	sweep->separator = separator;
+}
+
+
+// Read the next interval of the streamed times file, returns false at the end of the file
+static bool SummaryStreamRead(summary_sweep_t *sweep)
+{
+	times_reader_t *reader = sweep->timesReader;
+	times_t *times = sweep->times;
+	while (!sweep->timesEnded)
+	{
+		timestamp_t lastEnd = reader->lastEnd;
+		if (!TimesRead(reader, times))
+		{
+			sweep->timesEnded = true;
+			break;
+		}
+		if (reader->overlapping)
+		{
+			fprintf(stderr, "ERROR: Line %d has an interval that starts before a preceeding interval ends (not possible when streaming), ignoring it.\n", CsvLineNumber(&reader->csv));
+			reader->err++;
+			reader->overlapping = false;
+			reader->lastEnd = lastEnd;
+			times->numIntervals--;
+			times->labelsLength = times->labelOffset[times->numIntervals];
+			continue;
+		}
+		return true;
+	}
+	return false;
+}
+
+
+// Write the intervals at the front that end before the given time (or all of them), discarding them once they are at least half of those held
+static void SummaryStreamWrite(summary_sweep_t *sweep, bool all, timestamp_t time)
+{
+	times_t *times = sweep->times;
+	while (sweep->written < times->numIntervals && (all || times->end[sweep->written] < time))
+	{
+		SummaryWriteRow(sweep->output, &sweep->formatter, sweep->settings, sweep->separator, times, sweep->written);
+		sweep->writtenEnd = times->end[sweep->written];
+		sweep->written++;
+	}
+	if (sweep->cursor < sweep->written)
+	{
+		sweep->cursor = sweep->written;
+	}
+	if (sweep->written >= OMSUMMARY_STREAM_DISCARD && 2 * sweep->written >= times->numIntervals)
+	{
+		TimesDiscard(times, sweep->written);
+		sweep->cursor -= sweep->written;
+		sweep->written = 0;
+	}
+}
+
+
+// Before accumulating an event: read the intervals that start before it ends, and write those that end before it starts
+static void SummaryStreamAdvance(summary_sweep_t *sweep, timestamp_t start, timestamp_t end)
+{
+	times_t *times = sweep->times;
+	if (start < sweep->writtenEnd)
+	{
+		sweep->lateEvents++;
+	}
+	SummaryStreamWrite(sweep, false, start);
+	while (!sweep->timesEnded && (times->numIntervals <= sweep->written || times->start[times->numIntervals - 1] <= end))
+	{
+		if (SummaryStreamRead(sweep))
+		{
+			SummaryStreamWrite(sweep, false, start);
+		}
+	}
+}
+
+
+// Accumulate an event from the sort
+static void SummarySweepSorted(void *context, timestamp_t start, timestamp_t end)
+{
+	summary_sweep_t *sweep = (summary_sweep_t *)context;
+	SummaryAddEvent(sweep->times, &sweep->cursor, start, end);
+}
+
+
+// Accumulate an event, or (with a memory budget) sort the events from the first found out of order to accumulate when the sweep is finished
+static void SummarySweepAdd(summary_sweep_t *sweep, timestamp_t start, timestamp_t end)
+{
+	if (!sweep->sorted && sweep->sortMemory > 0 && start < sweep->lastStart)
+	{
+		fprintf(stderr, "Sorting data: the rows are not in order.\n");
+		sweep->sorted = true;
+		sweep->sorting = EventSortInit(&sweep->sort, sweep->sortMemory);
+		if (!sweep->sorting)
+		{
+			fprintf(stderr, "WARNING: Out of memory sorting the data.\n");
+		}
+	}
+	if (sweep->sorting)
+	{
+		if (EventSortAdd(&sweep->sort, start, end))
+		{
+			return;
+		}
+		fprintf(stderr, "WARNING: Problem writing the sorted data to a temporary file, the remaining data is not sorted.\n");
+		sweep->sorting = false;
+	}
+	if (sweep->timesReader != NULL)
+	{
+		SummaryStreamAdvance(sweep, start, end);
+	}
+	SummaryAddEvent(sweep->times, &sweep->cursor, start, end);
+	if (start > sweep->lastStart)
+	{
+		sweep->lastStart = start;
+	}
+}
+
+
+// Finish the sweep, accumulating any sorted events
+static void SummarySweepFinish(summary_sweep_t *sweep)
+{
+	if (sweep->sorted)
+	{
+		if (!EventSortFinish(&sweep->sort, SummarySweepSorted, sweep))
+		{
+			fprintf(stderr, "ERROR: Problem reading the sorted data from a temporary file.\n");
+		}
+		EventSortFree(&sweep->sort);
+		sweep->sorted = false;
+		sweep->sorting = false;
+	}
+
+	// Write the remaining streamed intervals, reading the rest of the times file
+	if (sweep->timesReader != NULL)
+	{
+		do
+		{
+			SummaryStreamWrite(sweep, true, 0);
+		} while (SummaryStreamRead(sweep));
+		if (sweep->lateEvents > 0)
+		{
+			fprintf(stderr, "WARNING: %d data row(s) were not in order, and too late for the intervals already written.\n", sweep->lateEvents);
+		}
+		sweep->timesReader = NULL;
+	}
+}
+
+
+// Columns of the data file
+typedef struct
+{
+	int start;
+	int end;
+	int duration;
+} data_columns_t;
+
+// Warnings about individual rows of the data file
+typedef enum
+{
+	DATA_WARNING_NONE = 0,
+	DATA_WARNING_INVALID_DURATION,
+	DATA_WARNING_DURATION_MISMATCH,
+	DATA_WARNING_TOO_FEW_COLUMNS,
+} data_warning_t;
+
+// A warning about a row of the data file
+typedef struct
+{
+	int line;
+	data_warning_t warning;
+} data_row_warning_t;
+
+
+// Report a warning about a row of the data file
+static void SummaryDataWarning(data_warning_t warning, int line)
+{
+	switch (warning)
+	{
+		case DATA_WARNING_INVALID_DURATION: fprintf(stderr, "WARNING: Invalid duration on data line %d.\n", line); break;
+		case DATA_WARNING_DURATION_MISMATCH: fprintf(stderr, "WARNING: Duration does not match (end - start) on data line %d.", line); break;
+		case DATA_WARNING_TOO_FEW_COLUMNS: fprintf(stderr, "WARNING: Too-few columns, ignoring row on line %d.\n", line); break;
+		default: break;
+	}
+}
+
+
+// Parse the current row of the data file in to an event, returns false if the row is not an event (and sets any warning about the row)
+static bool SummaryParseEvent(csv_load_t *csv, int tokens, const data_columns_t *columns, time_parser_t *startParser, time_parser_t *endParser, timestamp_t *start, timestamp_t *end, timestamp_t *duration, data_warning_t *warning)
+{
+	*warning = DATA_WARNING_NONE;
+	if (tokens <= columns->start)
+	{
+		if (tokens > 0)	// Ignore completely blank lines
+		{
+			*warning = DATA_WARNING_TOO_FEW_COLUMNS;
+		}
+		return false;
+	}
+
+	// Event time
+	*start = TokenTime(csv, columns->start, startParser);
+
+	// Default to an instantaneous event if no end
+	*end = *start;
+
+	// When given end time (an empty one is treated as missing)
+	int endLength = 0;
+	if (columns->end >= 0 && tokens > columns->end) { CsvTokenSpan(csv, columns->end, &endLength); }
+	if (endLength > 0)
+	{
+		*end = TokenTime(csv, columns->end, endParser);
+	}
+	*duration = *end - *start;
+
+	// When given a specific duration, use that
+	int durationLength = 0;
+	const char *durationToken = (columns->duration >= 0) ? CsvTokenSpan(csv, columns->duration, &durationLength) : NULL;
+	if (durationLength > 0)
+	{
+		double value;
+		if (!NumericParseDouble(durationToken, (size_t)durationLength, &value))
+		{
+			*warning = DATA_WARNING_INVALID_DURATION;
+		}
+		else
+		{
+			if (*end != *start && fabs(value - TimeTicksToSeconds(*end - *start)) > 0.01)
+			{
+				*warning = DATA_WARNING_DURATION_MISMATCH;
+			}
+			*duration = TimeSecondsToTicks(value);
+		}
+	}
+
+//fprintf(stderr, "@%s, %f\n", TimeString(TimeTicksToSeconds(*start), NULL), TimeTicksToSeconds(*duration));
+
+	return true;
+}
+
+
+// A chunk of the data file parsed by a thread
+typedef struct
+{
+	csv_load_t csv;					// Reader for the chunk's range of lines
+	const data_columns_t *columns;
+	time_parser_t startParser;
+	time_parser_t endParser;
+	event_cache_t events;			// Parsed events (reused for each chunk)
+	data_row_warning_t *warnings;	// Warnings, with line numbers from the start of the chunk (reused for each chunk)
+	int numWarnings;
+	int capacityWarnings;
+	bool ok;						// The chunk was parsed
+	thread_t thread;
+} summary_parse_task_t;
+
+
+// Parse thread: parse a chunk of lines in to its own events and warnings
+static void *SummaryParseThread(void *arg)
+{
+	summary_parse_task_t *task = (summary_parse_task_t *)arg;
+	task->events.numEvents = 0;
+	task->numWarnings = 0;
+	task->ok = true;
+	int tokens;
+	while ((tokens = CsvReadLine(&task->csv)) >= 0)
+	{
+		timestamp_t start, end, duration;
+		data_warning_t warning;
+		bool event = SummaryParseEvent(&task->csv, tokens, task->columns, &task->startParser, &task->endParser, &start, &end, &duration, &warning);
+		if (warning != DATA_WARNING_NONE)
+		{
+			if (task->numWarnings + 1 > task->capacityWarnings)
+			{
+				int capacity = 15 * task->capacityWarnings / 10 + 16;	// Grow by ~1.5x
+				data_row_warning_t *warnings = (data_row_warning_t *)realloc(task->warnings, capacity * sizeof(data_row_warning_t));
+				if (warnings == NULL) { task->ok = false; break; }
+				task->warnings = warnings;
+				task->capacityWarnings = capacity;
+			}
+			task->warnings[task->numWarnings].line = CsvLineNumber(&task->csv);
+			task->warnings[task->numWarnings].warning = warning;
+			task->numWarnings++;
+		}
+		if (event && !EventCacheAdd(&task->events, start, end, duration))
+		{
+			task->ok = false;
+			break;
+		}
+	}
+	return NULL;
+}
+
+
+// Parse a range of lines of a memory-mapped data file in chunks on several threads, then accumulate each chunk's events in order (identical to parsing serially), returns the offset and number of the last line read up to, and false if any chunk was not fully parsed
+static bool SummaryReadDataParallel(csv_load_t *csv, size_t begin, size_t end, int firstLine, int numThreads, const data_columns_t *columns, time_parser_t *startParser, time_parser_t *endParser, summary_sweep_t *sweep, event_cache_t **buildCache, size_t *dataOffset, int *dataLine)
+{
+	summary_parse_task_t *tasks = (summary_parse_task_t *)calloc(numThreads, sizeof(summary_parse_task_t));
+	if (tasks == NULL)
+	{
+		fprintf(stderr, "ERROR: Out of memory parsing the data.\n");
+		return false;
+	}
+
+	// Each round parses a chunk per thread, bounding the memory used
+	bool ok = true;
+	int line = firstLine;
+	size_t offset = begin;
+	while (offset < end)
+	{
+		int started = 0;
+		for (int t = 0; t < numThreads && offset < end; t++)
+		{
+			summary_parse_task_t *task = &tasks[t];
+			size_t chunkEnd = CsvLineEnd(csv, offset + OMSUMMARY_PARSE_CHUNK - 1);
+			if (chunkEnd > end) { chunkEnd = end; }
+			if (!CsvOpenRange(&task->csv, csv, offset, chunkEnd))
+			{
+				break;
+			}
+			offset = chunkEnd;
+			task->columns = columns;
+			task->startParser = *startParser;
+			task->endParser = *endParser;
+
+			// The first chunk is parsed on this thread once the others are started (as is any chunk whose thread cannot be started)
+			task->thread.function = NULL;
+			if (t > 0 && !ThreadCreate(&task->thread, SummaryParseThread, task))
+			{
+				SummaryParseThread(task);
+				task->thread.function = NULL;
+			}
+			started++;
+		}
+		if (started == 0)
+		{
+			fprintf(stderr, "ERROR: Out of memory parsing the data.\n");
+			ok = false;
+			break;
+		}
+		SummaryParseThread(&tasks[0]);
+
+		// Accumulate the chunks in order
+		for (int t = 0; t < started; t++)
+		{
+			summary_parse_task_t *task = &tasks[t];
+			if (task->thread.function != NULL)
+			{
+				ThreadJoin(&task->thread);
+			}
+			if (!task->ok)
+			{
+				fprintf(stderr, "ERROR: Out of memory parsing the data from line %d.\n", line);
+				ok = false;
+			}
+			for (int i = 0; i < task->numWarnings; i++)
+			{
+				SummaryDataWarning(task->warnings[i].warning, line + task->warnings[i].line - 1);
+			}
+			for (size_t i = 0; i < task->events.numEvents; i++)
+			{
+				SummarySweepAdd(sweep, task->events.start[i], task->events.end[i]);
+				if (*buildCache != NULL && !EventCacheAdd(*buildCache, task->events.start[i], task->events.end[i], task->events.duration[i]))
+				{
+					fprintf(stderr, "WARNING: Out of memory building the cache.\n");
+					EventCacheClose(*buildCache);
+					*buildCache = NULL;
+				}
+			}
+			line += CsvLineNumber(&task->csv);
+			CsvClose(&task->csv);
+		}
+	}
+
+	for (int t = 0; t < numThreads; t++)
+	{
+		EventCacheClose(&tasks[t].events);
+		free(tasks[t].warnings);
+	}
+	free(tasks);
+	*dataOffset = offset;
+	*dataLine = line - 1;
+	return ok;
+}
+
+
+// A batch of parsed events passed from the parse thread to the accumulating thread
+typedef struct
+{
+	int count;
+	bool last;						// The final batch
+	timestamp_t start[OMSUMMARY_PIPELINE_BATCH];
+	timestamp_t end[OMSUMMARY_PIPELINE_BATCH];
+	timestamp_t duration[OMSUMMARY_PIPELINE_BATCH];
+} summary_batch_t;
+
+// Pipelined parsing: batches of events pass between the parse thread and the accumulating thread
+typedef struct
+{
+	csv_load_t *csv;
+	const data_columns_t *columns;
+	time_parser_t *startParser;
+	time_parser_t *endParser;
+	ring_t full;					// Parsed batches, to the accumulating thread
+	ring_t empty;					// Batches to fill, to the parse thread
+	thread_t thread;
+} summary_pipeline_t;
+
+
+// Fill a batch with the events of the next rows of the data file (the final batch is not full)
+static void SummaryPipelineFill(summary_pipeline_t *pipeline, summary_batch_t *batch)
+{
+	batch->count = 0;
+	int tokens;
+	while (batch->count < OMSUMMARY_PIPELINE_BATCH && (tokens = CsvReadLine(pipeline->csv)) >= 0)
+	{
+		data_warning_t warning;
+		if (SummaryParseEvent(pipeline->csv, tokens, pipeline->columns, pipeline->startParser, pipeline->endParser, &batch->start[batch->count], &batch->end[batch->count], &batch->duration[batch->count], &warning))
+		{
+			batch->count++;
+		}
+		if (warning != DATA_WARNING_NONE)
+		{
+			SummaryDataWarning(warning, CsvLineNumber(pipeline->csv));
+		}
+	}
+	batch->last = (batch->count < OMSUMMARY_PIPELINE_BATCH);
+}
+
+
+// Parse thread: fill batches until the end of the data file
+static void *SummaryPipelineThread(void *arg)
+{
+	summary_pipeline_t *pipeline = (summary_pipeline_t *)arg;
+	for (bool last = false; !last; )
+	{
+		summary_batch_t *batch = (summary_batch_t *)RingPopWait(&pipeline->empty);
+		SummaryPipelineFill(pipeline, batch);
+		last = batch->last;
+		RingPushWait(&pipeline->full, batch);
+	}
+	return NULL;
+}
+
+
+// Parse the data on another thread, while accumulating the events in order on this thread
+static void SummaryReadDataPipeline(csv_load_t *csv, const data_columns_t *columns, time_parser_t *startParser, time_parser_t *endParser, summary_sweep_t *sweep, event_cache_t **buildCache)
+{
+	summary_pipeline_t pipeline;
+	memset(&pipeline, 0, sizeof(pipeline));
+	pipeline.csv = csv;
+	pipeline.columns = columns;
+	pipeline.startParser = startParser;
+	pipeline.endParser = endParser;
+	summary_batch_t *batches = (summary_batch_t *)malloc(OMSUMMARY_PIPELINE_BATCHES * sizeof(summary_batch_t));
+	if (batches == NULL || !RingInit(&pipeline.full, OMSUMMARY_PIPELINE_BATCHES) || !RingInit(&pipeline.empty, OMSUMMARY_PIPELINE_BATCHES))
+	{
+		fprintf(stderr, "ERROR: Out of memory parsing the data.\n");
+		free(batches);
+		RingFree(&pipeline.full);
+		RingFree(&pipeline.empty);
+		return;
+	}
+	for (int i = 0; i < OMSUMMARY_PIPELINE_BATCHES; i++)
+	{
+		RingPush(&pipeline.empty, &batches[i]);
+	}
+
+	// Without a parse thread, fill and accumulate each batch in turn on this thread
+	bool threaded = ThreadCreate(&pipeline.thread, SummaryPipelineThread, &pipeline);
+	for (bool last = false; !last; )
+	{
+		summary_batch_t *batch;
+		if (threaded)
+		{
+			batch = (summary_batch_t *)RingPopWait(&pipeline.full);
+		}
+		else
+		{
+			batch = &batches[0];
+			SummaryPipelineFill(&pipeline, batch);
+		}
+		for (int i = 0; i < batch->count; i++)
+		{
+			SummarySweepAdd(sweep, batch->start[i], batch->end[i]);
+			if (*buildCache != NULL && !EventCacheAdd(*buildCache, batch->start[i], batch->end[i], batch->duration[i]))
+			{
+				fprintf(stderr, "WARNING: Out of memory building the cache.\n");
+				EventCacheClose(*buildCache);
+				*buildCache = NULL;
+			}
+		}
+		last = batch->last;
+		if (threaded)
+		{
+			RingPushWait(&pipeline.empty, batch);
+		}
+	}
+
+	if (threaded)
+	{
+		ThreadJoin(&pipeline.thread);
+	}
+	RingFree(&pipeline.full);
+	RingFree(&pipeline.empty);
+	free(batches);
+}
+
+
+// Set when interrupted, to stop following the data file
+static volatile sig_atomic_t summaryStop = 0;
+
+
+// Interrupt: stop following the data file (then summarize as usual), a second interrupt is not caught
+static void SummaryInterrupt(int sig)
+{
+	summaryStop = 1;
+	signal(sig, SIG_DFL);
+}
+
+
+// Before waiting for more data to follow: flush the rows written so far
+static void SummaryFollowIdle(void *context)
+{
+	summary_sweep_t *sweep = (summary_sweep_t *)context;
+	if (sweep->output != NULL)
+	{
+		OutputFlush(sweep->output);
+	}
+}
+
+
+// Report a file being opened or saved (unless quiet)
+static void SummaryStatus(omsummary_settings_t *settings, const char *action, const char *filename)
+{
+	if (!settings->quiet)
+	{
+		fprintf(stderr, "%s: %s\n", action, filename);
+	}
+}
+
+
+// Parse a partial last line of the data file, left unread when only reading whole lines, in to events (rather than accumulating them), returns false if out of memory
+static bool SummaryReadPartial(csv_load_t *csv, const data_columns_t *columns, time_parser_t *startParser, time_parser_t *endParser, event_cache_t *partial)
+{
+	CsvWholeLines(csv, false);
+	int tokens = CsvReadLine(csv);
+	if (tokens < 0)
+	{
+		return true;
+	}
+	timestamp_t start, end, duration;
+	data_warning_t warning;
+	bool event = SummaryParseEvent(csv, tokens, columns, startParser, endParser, &start, &end, &duration, &warning);
+	if (warning != DATA_WARNING_NONE)
+	{
+		SummaryDataWarning(warning, CsvLineNumber(csv));
+	}
+	if (event && !EventCacheAdd(partial, start, end, duration))
+	{
+		fprintf(stderr, "ERROR: Out of memory parsing the data on line %d.\n", CsvLineNumber(csv));
+		return false;
+	}
+	return true;
+}
+
+
+// Parse the data file, accumulating each event in to the intervals, and in to the cache and index being built (if any, set to NULL if they could not be built), skipping data using the seek index (if any), resuming from (if not zero) and returning the offset and number of the last line read up to (optionally only reading whole lines, with the events of a partial last line parsed in to partial rather than accumulated), returns false if there was a problem opening or reading the data
+static bool SummaryReadData(omsummary_settings_t *settings, summary_sweep_t *sweep, event_cache_t **buildCache, seek_index_t **buildIndex, seek_index_t *seekIndex, size_t *dataOffset, int *dataLine, event_cache_t *partial)
+{
+	csv_load_t csv;
+	int colStart = -1, colEnd = -1, colDuration = -1;
+	if (settings->filename != NULL && settings->filename[0] != '\0')
+	{
+		SummaryStatus(settings, "Opening data", settings->filename);
+	}
+
+	// Optionally follow a growing file, or read on another thread (not when using the index)
+	bool following = false, pipeline = false;
+	follow_reader_t follow;
+	stream_reader_t reader;
+	FILE *fp = NULL;
+	if (settings->follow && settings->filename != NULL && settings->filename[0] != '\0')
+	{
+		following = FollowReaderOpen(&follow, settings->filename, &summaryStop, SummaryFollowIdle, sweep);
+	}
+	else if (settings->pipeline && *buildIndex == NULL && seekIndex == NULL && *dataOffset == 0)
+	{
+		fp = (settings->filename == NULL || settings->filename[0] == '\0') ? stdin : fopen(settings->filename, "rb");
+		pipeline = (fp != NULL && StreamReaderStart(&reader, fp));
+		if (!pipeline && fp != NULL && fp != stdin)
+		{
+			fclose(fp);
+		}
+	}
+	int headerCells;
+	if (following)
+	{
+		headerCells = CsvOpenStream(&csv, FollowRead, &follow, CSV_HEADER_DETECT_NON_NUMERIC, CSV_SEPARATORS);
+	}
+	else if (pipeline)
+	{
+		headerCells = CsvOpenStream(&csv, StreamRead, &reader, CSV_HEADER_DETECT_NON_NUMERIC, CSV_SEPARATORS);
+	}
+	else
+	{
+		headerCells = CsvOpen(&csv, settings->filename, CSV_HEADER_DETECT_NON_NUMERIC, CSV_SEPARATORS);
+	}
+	if (CsvError(&csv))
+	{
+		CsvClose(&csv);
+		if (pipeline)
+		{
+			StreamReaderStop(&reader);
+			if (fp != stdin)
+			{
+				fclose(fp);
+			}
+		}
+		if (following)
+		{
+			FollowReaderClose(&follow);
+		}
+		return false;
+	}
+	if (headerCells > 0)
+	{
+		// Parse header cells
+		int i;
+		for (i = 0; i < headerCells; i++)
+		{
+			const char *heading = CsvTokenString(&csv, i);
+
+			if (!_strcasecmp(heading, "Start")) { colStart = i; }
+			else if (!_strcasecmp(heading, "End")) { colEnd = i; }
+			else if (!_strcasecmp(heading, "Duration(s)")) { colDuration = i; }
+			else
+			{
+				fprintf(stderr, "WARNING: Unknown data column %d heading: '%s'.\n", i + 1, heading);
+			}
+		}
+	}
+
+	if (colStart < 0 && colEnd < 0 && colDuration < 0)
+	{
+		fprintf(stderr, "WARNING: No recognized data heading line -- default columns will be used.\n");
+		colStart = 0;
+		colEnd = 1;
+		colDuration = 2;
+	}
+
+	if (colStart < 0)
+	{
+		fprintf(stderr, "ERROR: One or more required data columns ('start') is missing.\n");
+	}
+
+	// A partial last line is left to be read once it has been written
+	if (partial != NULL)
+	{
+		CsvWholeLines(&csv, true);
+	}
+
+	// Only tokenize the required columns
+	CsvProjectColumn(&csv, colStart);
+	CsvProjectColumn(&csv, colEnd);
+	CsvProjectColumn(&csv, colDuration);
+
+
+	data_columns_t columns = { colStart, colEnd, colDuration };
+	time_parser_t startParser, endParser;
+	TimeParserInit(&startParser);
+	TimeParserInit(&endParser);
+
+	// Resume after the data already read
+	if (*dataOffset > 0 && !CsvSeek(&csv, *dataOffset, *dataLine + 1))
+	{
+		fprintf(stderr, "ERROR: Problem resuming the data from line %d.\n", *dataLine + 1);
+		CsvClose(&csv);
+		return false;
+	}
+
+	// Pipelined: parse on another thread while accumulating on this thread
+	if (pipeline)
+	{
+		SummaryReadDataPipeline(&csv, &columns, &startParser, &endParser, sweep, buildCache);
+		*dataOffset = CsvLineOffset(&csv);
+		*dataLine = CsvLineNumber(&csv);
+		bool ok = !CsvError(&csv) && (partial == NULL || SummaryReadPartial(&csv, &columns, &startParser, &endParser, partial));
+		CsvClose(&csv);
+		StreamReaderStop(&reader);
+		if (ferror(fp))
+		{
+			fprintf(stderr, "ERROR: Problem reading the data.\n");
+			ok = false;
+		}
+		if (fp != stdin)
+		{
+			fclose(fp);
+		}
+		return ok;
+	}
+
+	// Large memory-mapped files are parsed in chunks on several threads (unless using the index)
+	int numThreads = (settings->threads > 0) ? settings->threads : ThreadProcessorCount();
+	size_t begin, end;
+	int firstLine;
+	if (numThreads > 1 && *buildIndex == NULL && seekIndex == NULL && CsvRemaining(&csv, &begin, &end, &firstLine) && end - begin > 2 * OMSUMMARY_PARSE_CHUNK)
+	{
+		// Detect the time formats from the first rows, for every chunk to use
+		for (int i = 0; i < OMSUMMARY_PARSE_PROBE_ROWS; i++)
+		{
+			timestamp_t start, end, duration;
+			data_warning_t warning;
+			int tokens = CsvReadLine(&csv);
+			if (tokens < 0) { break; }
+			SummaryParseEvent(&csv, tokens, &columns, &startParser, &endParser, &start, &end, &duration, &warning);
+		}
+		bool ok = SummaryReadDataParallel(&csv, begin, end, firstLine, numThreads, &columns, &startParser, &endParser, sweep, buildCache, dataOffset, dataLine);
+		if (CsvError(&csv)) { ok = false; }
+		if (ok && partial != NULL)
+		{
+			ok = CsvSeek(&csv, *dataOffset, *dataLine + 1) && SummaryReadPartial(&csv, &columns, &startParser, &endParser, partial);
+		}
+		CsvClose(&csv);
+		return ok;
+	}
+
+	int seekCursor = -1;
+	int rows = 0;
+	timestamp_t maxEnd = INT64_MIN;
+	int tokens;
+	for (;;)
+	{
+		// Seek forward when the index shows that the intervening rows all end before the next interval
+		if (seekIndex != NULL && sweep->cursor != seekCursor)
+		{
+			if (sweep->cursor >= sweep->times->numIntervals)
+			{
+				break;		// No intervals remain
+			}
+			seekCursor = sweep->cursor;
+			int entry = SeekIndexFind(seekIndex, sweep->times->start[sweep->cursor]);
+			if (entry >= 0 && seekIndex->line[entry] > CsvLineNumber(&csv) + 1)
+			{
+				CsvSeek(&csv, (size_t)seekIndex->offset[entry], (int)seekIndex->line[entry]);
+			}
+		}
+
+		if ((tokens = CsvReadLine(&csv)) < 0)
+		{
+			break;
+		}
+
+		// Sample the index being built
+		if (*buildIndex != NULL && rows++ % SEEK_INDEX_ROWS == 0 && !SeekIndexAdd(*buildIndex, maxEnd, CsvLineOffset(&csv), CsvLineNumber(&csv)))
+		{
+			fprintf(stderr, "WARNING: Out of memory building the index.\n");
+			SeekIndexClose(*buildIndex);
+			*buildIndex = NULL;
+		}
+
+		timestamp_t start, end, duration;
+		data_warning_t warning;
+		bool event = SummaryParseEvent(&csv, tokens, &columns, &startParser, &endParser, &start, &end, &duration, &warning);
+		if (warning != DATA_WARNING_NONE)
+		{
+			SummaryDataWarning(warning, CsvLineNumber(&csv));
+		}
+		if (event)
+		{
+			// The index can only skip rows of data that is in order (each row starting after all earlier rows end)
+			if (*buildIndex != NULL && start < maxEnd)
+			{
+				fprintf(stderr, "WARNING: Data rows are not in order (line %d), the index will not be used.\n", CsvLineNumber(&csv));
+				SeekIndexClose(*buildIndex);
+				*buildIndex = NULL;
+			}
+			SummarySweepAdd(sweep, start, end);
+			if (end > maxEnd)
+			{
+				maxEnd = end;
+			}
+			if (*buildCache != NULL && !EventCacheAdd(*buildCache, start, end, duration))
+			{
+				fprintf(stderr, "WARNING: Out of memory building the cache.\n");
+				EventCacheClose(*buildCache);
+				*buildCache = NULL;
+			}
+		}
+	}
+
+
+	*dataOffset = CsvLineOffset(&csv);
+	*dataLine = CsvLineNumber(&csv);
+	bool ok = !CsvError(&csv);
+	if (ok && partial != NULL && !following)
+	{
+		ok = SummaryReadPartial(&csv, &columns, &startParser, &endParser, partial);
+	}
+	CsvClose(&csv);
+	if (following && FollowReaderClose(&follow) > 0)
+	{
+		fprintf(stderr, "WARNING: Ignoring a partial last line of the data.\n");
+	}
+	return ok;
+}
+
+
+// Summarizer of events held in memory: the intervals, and the sweep of the events in to them
+struct omsummary_tag
+{
+	omsummary_settings_t settings;
+	times_t times;
+	summary_sweep_t sweep;
+	timestamp_t lastEnd;		// Latest end of the intervals added
+	bool overlapping;			// An interval starts before a preceeding interval ends
+	bool started;				// Events have been added (no more intervals)
+};
+
+
+// Initialize the settings to their defaults
+void OmSummarySettingsInit(omsummary_settings_t *settings)
+{
+	memset(settings, 0, sizeof(omsummary_settings_t));
+	settings->scale = 1.0;				// "1/60" for minutes
+	settings->scaleProp = 1.0;			// "100" for percentage
+	settings->countOffset = 0;			// "-1" to report count-1
+	settings->header = NULL;
+	settings->separator = NULL;
+	settings->threads = 0;				// One per processor
+}
+
+
+// Create a summarizer, returns NULL if out of memory
+omsummary_t *OmSummaryCreate(const omsummary_settings_t *settings)
+{
+	omsummary_t *summary = (omsummary_t *)calloc(1, sizeof(omsummary_t));
+	if (summary == NULL)
+	{
+		return NULL;
+	}
+	if (settings != NULL)
+	{
+		summary->settings = *settings;
+	}
+	else
+	{
+		OmSummarySettingsInit(&summary->settings);
+	}
+	summary->lastEnd = INT64_MIN;
+	SummarySweepInit(&summary->sweep, &summary->times, (summary->settings.sortMemory > 0) ? (size_t)summary->settings.sortMemory * 1024 * 1024 : 0);
+	return summary;
+}
+
+
+// Add an interval, returns false if out of memory, the interval is negative, or events have been added
+bool OmSummaryAddInterval(omsummary_t *summary, const char *label, timestamp_t start, timestamp_t end)
+{
+	if (summary->started || end < start)
+	{
+		return false;
+	}
+	if (label == NULL)
+	{
+		label = "";
+	}
+	if (!TimesAdd(&summary->times, label, (int)strlen(label), start, end))
+	{
+		return false;
+	}
+	if (start < summary->lastEnd)
+	{
+		summary->overlapping = true;
+	}
+	if (end > summary->lastEnd)
+	{
+		summary->lastEnd = end;
+	}
+	return true;
+}
+
+
+// Add the intervals of a times file, returns false if there was a problem with the file, or events have been added
+bool OmSummaryAddTimesFile(omsummary_t *summary, const char *timesFilename)
+{
+	times_reader_t reader;
+	if (summary->started || !TimesOpen(&reader, timesFilename))
+	{
+		return false;
+	}
+	reader.lastEnd = summary->lastEnd;
+	while (TimesRead(&reader, &summary->times)) { ; }
+	TimesClose(&reader);
+	summary->lastEnd = reader.lastEnd;
+	summary->overlapping |= reader.overlapping;
+	return reader.err == 0;
+}
+
+
+// Fix the intervals before the first event, building the interval tree if they overlap, returns false if out of memory
+static bool OmSummaryStart(omsummary_t *summary)
+{
+	if (!summary->started)
+	{
+		if (summary->overlapping && !TimesIndex(&summary->times))
+		{
+			fprintf(stderr, "ERROR: Out of memory indexing the intervals.\n");
+			return false;
+		}
+		summary->started = true;
+	}
+	return true;
+}
+
+
+// Add an event, returns false if there was a problem
+bool OmSummaryAddEvent(omsummary_t *summary, timestamp_t start, timestamp_t end)
+{
+	if (!OmSummaryStart(summary))
+	{
+		return false;
+	}
+	SummarySweepAdd(&summary->sweep, start, end);
+	return true;
+}
+
+
+// Add a batch of events as arrays, returns false if there was a problem
+bool OmSummaryAddEvents(omsummary_t *summary, size_t count, const timestamp_t *start, const timestamp_t *end)
+{
+	if (!OmSummaryStart(summary))
+	{
+		return false;
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		SummarySweepAdd(&summary->sweep, start[i], end[i]);
+	}
+	return true;
+}
+
+
+// Number of intervals
+int OmSummaryCount(omsummary_t *summary)
+{
+	return summary->times.numIntervals;
+}
+
+
+// Get the summary of an interval, returns false if there is no such interval
+bool OmSummaryResult(omsummary_t *summary, int index, omsummary_result_t *result)
+{
+	times_t *times = &summary->times;
+	if (index < 0 || index >= times->numIntervals)
+	{
+		return false;
+	}
+	SummarySweepFinish(&summary->sweep);
+	result->label = times->labels + times->labelOffset[index];
+	result->start = times->start[index];
+	result->end = times->end[index];
+	result->first = times->first[index];
+	result->last = times->last[index];
+	result->duration = times->duration[index];
+	result->count = times->count[index];
+	return true;
+}
+
+
+// Write the summary (optionally directly to the file's descriptor), returns false if there was an error
+static bool SummaryWrite(omsummary_t *summary, FILE *fp, bool direct)
+{
+	omsummary_settings_t *settings = &summary->settings;
+	const char *separator = (settings->separator != NULL) ? settings->separator : ",";
+	SummarySweepFinish(&summary->sweep);
+
+	output_t output;
+	OutputInit(&output, fp);
+	if (direct)
+	{
+		OutputDirect(&output);
+	}
+	SummaryWriteHeader(&output, settings, separator);
+	bool ok = SummaryWriteRows(&output, settings, separator, &summary->times);
+	return OutputClose(&output) && ok;
+}
+
+
+// Write the summary (through the stdio stream, which may have no descriptor), returns false if there was an error
+bool OmSummaryWrite(omsummary_t *summary, FILE *fp)
+{
+	return SummaryWrite(summary, fp, false);
+}
+
+
+// Free a summarizer
+void OmSummaryFree(omsummary_t *summary)
+{
+	if (summary == NULL)
+	{
+		return;
+	}
+	if (summary->sweep.sorted)
+	{
+		EventSortFree(&summary->sweep.sort);
+	}
+	TimesFree(&summary->times);
+	free(summary);
+}
+
+
+// Summarize a data file in to the intervals of a times file, writing the output file
+int OmSummaryRun(omsummary_settings_t *settings)
+{
+	// The data file is read in to a summarizer, as for events held in memory
+	omsummary_t *summary = OmSummaryCreate(settings);
+	if (summary == NULL)
+	{
+		fprintf(stderr, "ERROR: Out of memory.\n");
+		return -1;
+	}
+	times_t *times = &summary->times;
+	summary_sweep_t *sweep = &summary->sweep;
+
+	// Load times (or, when streaming, read them as the data reaches them)
+	SummaryStatus(settings, "Opening times", settings->timesFilename);
+	times_reader_t timesReader;
+	bool streaming = false;
+	int ret = 0;
+	if (settings->stream || settings->follow)
+	{
+		summary->started = true;
+		streaming = TimesOpen(&timesReader, settings->timesFilename);
+		if (!streaming)
+		{
+			fprintf(stderr, "ERROR: There was a problem with the times data: %s\n", settings->timesFilename);
+			ret = -1;
+		}
+		if (settings->sortMemory > 0)
+		{
+			fprintf(stderr, "WARNING: The data rows are not sorted when streaming.\n");
+			sweep->sortMemory = 0;
+		}
+	}
+	else
+	{
+		// The intervals are indexed even after an error in the times file
+		bool loaded = OmSummaryAddTimesFile(summary, settings->timesFilename);
+		if (!OmSummaryStart(summary) || !loaded)
+		{
+			fprintf(stderr, "ERROR: There was a problem with the times data: %s\n", settings->timesFilename);
+			ret = -1;
+		}
+	}
+
+	// Open output
+	FILE *ofp;
+
+	if (settings->outFilename == NULL || settings->outFilename[0] == '\0')
+	{
+		ofp = stdout;
+	}
+	else
+	{
+		SummaryStatus(settings, "Saving data", settings->outFilename);
+		ofp = fopen(settings->outFilename, "wt");
+	}
+
+	if (ofp == NULL)
+	{
+		fprintf(stderr, "ERROR: Problem opening CSV file for output: %s\n", settings->outFilename);
+		if (streaming)
+		{
+			TimesClose(&timesReader);
+		}
+		OmSummaryFree(summary);
+		return -1;
+	}
+
+	// When streaming, the header (with custom separator) is written, then each row once the data has passed its interval
+	const char *separator = (settings->separator != NULL) ? settings->separator : ",";
+	output_t output;
+	if (streaming)
+	{
+		OutputInit(&output, ofp);
+		OutputDirect(&output);
+		SummaryWriteHeader(&output, settings, separator);
+		SummarySweepStream(sweep, &timesReader, &output, settings, separator);
+	}
+
+	// Load data, from the cache if valid
+	event_cache_t cache;
+	seek_index_t index;
+	bool cached = false, buildingCache = false, buildingIndex = false, indexed = false;
+	char *cacheFilename = NULL, *indexFilename = NULL;
+	size_t dataOffset = 0;
+	int dataLine = 0;
+
+	// Resume from the checkpoint, if it matches the times file and the data already read
+	bool checkpointing = false, resumed = false;
+	checkpoint_state_t resumedState;
+	event_cache_t partial;
+	memset(&partial, 0, sizeof(partial));
+	if (settings->checkpoint != NULL && settings->checkpoint[0] != '\0')
+	{
+		if (settings->filename == NULL || settings->filename[0] == '\0')
+		{
+			fprintf(stderr, "WARNING: The checkpoint is only used with an input file.\n");
+		}
+		else if (streaming)
+		{
+			fprintf(stderr, "WARNING: The checkpoint is not used when streaming.\n");
+		}
+		else
+		{
+			checkpointing = true;
+			checkpoint_t checkpoint;
+			if (CheckpointLoad(&checkpoint, settings->checkpoint, settings->timesFilename, settings->filename))
+			{
+				if (checkpoint.numIntervals == (size_t)times->numIntervals)
+				{
+					SummaryStatus(settings, "Resuming from checkpoint", settings->checkpoint);
+					for (int i = 0; i < times->numIntervals; i++)
+					{
+						times->first[i] = checkpoint.first[i];
+						times->last[i] = checkpoint.last[i];
+						times->duration[i] = checkpoint.duration[i];
+						times->count[i] = (int)checkpoint.count[i];
+					}
+					sweep->cursor = (int)checkpoint.state.cursor;
+					sweep->lastStart = checkpoint.state.lastStart;
+					dataOffset = (size_t)checkpoint.state.dataOffset;
+					dataLine = (int)checkpoint.state.dataLine;
+					resumedState = checkpoint.state;
+					resumed = true;
+				}
+				CheckpointClose(&checkpoint);
+			}
+			if (settings->cache || settings->index)
+			{
+				fprintf(stderr, "WARNING: The cache and index are not used with a checkpoint.\n");
+			}
+		}
+	}
+
+	if ((settings->cache || settings->index) && (settings->filename == NULL || settings->filename[0] == '\0'))
+	{
+		fprintf(stderr, "WARNING: The cache and index are only used with an input file.\n");
+	}
+	else if ((settings->cache || settings->index) && settings->follow)
+	{
+		fprintf(stderr, "WARNING: The cache and index are not used when following the input.\n");
+	}
+	else
+	{
+		if (settings->cache && !checkpointing && (cacheFilename = SummarySidecarFilename(settings->filename, OMSUMMARY_CACHE_EXTENSION)) != NULL)
+		{
+			if (EventCacheLoad(&cache, cacheFilename, settings->filename))
+			{
+				SummaryStatus(settings, "Using cache", cacheFilename);
+				OmSummaryAddEvents(summary, cache.numEvents, cache.start, cache.end);
+				EventCacheClose(&cache);
+				cached = true;
+			}
+			else
+			{
+				buildingCache = EventCacheInit(&cache, settings->filename);
+			}
+		}
+		if (!cached && settings->index && !checkpointing && (indexFilename = SummarySidecarFilename(settings->filename, OMSUMMARY_INDEX_EXTENSION)) != NULL)
+		{
+			if (SeekIndexLoad(&index, indexFilename, settings->filename))
+			{
+				SummaryStatus(settings, "Using index", indexFilename);
+				indexed = true;
+			}
+			else
+			{
+				buildingIndex = SeekIndexInit(&index, settings->filename);
+			}
+		}
+	}
+	if (!cached)
+	{
+		// Follow the data file until interrupted
+		if (settings->follow)
+		{
+			if (settings->filename == NULL || settings->filename[0] == '\0')
+			{
+				fprintf(stderr, "WARNING: Only an input file can be followed (reading stdin until it ends).\n");
+			}
+			else
+			{
+				fprintf(stderr, "Following data (interrupt to finish)...\n");
+				summaryStop = 0;
+				signal(SIGINT, SummaryInterrupt);
+				signal(SIGTERM, SummaryInterrupt);
+			}
+		}
+
+		// The whole file is read when building the cache
+		event_cache_t *buildCache = buildingCache ? &cache : NULL;
+		seek_index_t *buildIndex = buildingIndex ? &index : NULL;
+		if (!SummaryReadData(settings, sweep, &buildCache, &buildIndex, (indexed && !buildingCache && !streaming && times->order == NULL) ? &index : NULL, &dataOffset, &dataLine, checkpointing ? &partial : NULL))
+		{
+			// Nothing is saved of data that could not be read
+			fprintf(stderr, "ERROR: There was a problem with the data: %s\n", (settings->filename != NULL && settings->filename[0] != '\0') ? settings->filename : "(stdin)");
+			if (buildCache != NULL)
+			{
+				EventCacheClose(buildCache);
+				buildCache = NULL;
+			}
+			if (buildIndex != NULL)
+			{
+				SeekIndexClose(buildIndex);
+				buildIndex = NULL;
+			}
+			checkpointing = false;
+			ret = -1;
+		}
+		if (buildCache != NULL)
+		{
+			SummaryStatus(settings, "Saving cache", cacheFilename);
+			if (!EventCacheSave(buildCache, cacheFilename, settings->filename))
+			{
+				fprintf(stderr, "WARNING: Problem saving the cache, or the data changed while it was read: %s\n", cacheFilename);
+			}
+			EventCacheClose(buildCache);
+		}
+		if (buildIndex != NULL)
+		{
+			SummaryStatus(settings, "Saving index", indexFilename);
+			if (!SeekIndexSave(buildIndex, indexFilename, settings->filename))
+			{
+				fprintf(stderr, "WARNING: Problem saving the index, or the data changed while it was read: %s\n", indexFilename);
+			}
+			SeekIndexClose(buildIndex);
+		}
+		if (indexed)
+		{
+			SeekIndexClose(&index);
+		}
+	}
+	free(cacheFilename);
+	free(indexFilename);
+	SummarySweepFinish(sweep);
+
+	// Save the results so far, and how far through the data they reach
+	if (checkpointing)
+	{
+		int64_t *count = (int64_t *)malloc(sizeof(int64_t) * (times->numIntervals > 0 ? times->numIntervals : 1));
+		if (count != NULL)
+		{
+			for (int i = 0; i < times->numIntervals; i++)
+			{
+				count[i] = times->count[i];
+			}
+			checkpoint_t checkpoint;
+			memset(&checkpoint, 0, sizeof(checkpoint_t));
+			checkpoint.numIntervals = (size_t)times->numIntervals;
+			checkpoint.first = times->first;
+			checkpoint.last = times->last;
+			checkpoint.duration = times->duration;
+			checkpoint.count = count;
+			checkpoint.state.cursor = sweep->cursor;
+			checkpoint.state.lastStart = sweep->lastStart;
+			checkpoint.state.dataOffset = (int64_t)dataOffset;
+			checkpoint.state.dataLine = dataLine;
+			SummaryStatus(settings, "Saving checkpoint", settings->checkpoint);
+			if (!CheckpointSave(&checkpoint, settings->checkpoint, settings->timesFilename, settings->filename, resumed ? &resumedState : NULL))
+			{
+				fprintf(stderr, "WARNING: Problem saving the checkpoint: %s\n", settings->checkpoint);
+			}
+			free(count);
+		}
+		else
+		{
+			fprintf(stderr, "WARNING: Problem saving the checkpoint: %s\n", settings->checkpoint);
+		}
+	}
+
+	// A partial last line is in these results, but not the checkpoint (it is read again when resuming)
+	OmSummaryAddEvents(summary, partial.numEvents, partial.start, partial.end);
+	EventCacheClose(&partial);
+
+	// Output data
+	bool ok;
+	if (streaming)
+	{
+		// The rows have been written
+		TimesClose(&timesReader);
+		if (timesReader.err != 0)
+		{
+			fprintf(stderr, "ERROR: There was a problem with the times data: %s\n", settings->timesFilename);
+			ret = -1;
+		}
+		ok = OutputClose(&output);
+	}
+	else
+	{
+		ok = SummaryWrite(summary, ofp, true);
+	}
+
+	if (!ok)
+	{
+		fprintf(stderr, "ERROR: Problem writing CSV file for output: %s\n", settings->outFilename);
+		ret = -1;
+	}
+
+	if (ofp != stdout && fclose(ofp) != 0)
+	{
+		fprintf(stderr, "ERROR: Problem writing CSV file for output: %s\n", settings->outFilename);
+		ret = -1;
+	}
+	//ofp = NULL;
+
+	OmSummaryFree(summary);
+
+	return ret;
+}
@@ -29,6 +29,12 @@
 #ifndef OMSUMMARY_H
 #define OMSUMMARY_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "timestamp.h"
+
 typedef struct 
 { 
 	const char *filename;
@@ -39,8 +45,64 @@ typedef struct
 	int countOffset;				// Offset to apply to count (e.g. -1 = count-1)
 	const char *header;				// Custom header line (empty for no header line, NULL for default)
 	const char *separator;			// Custom output separator
+	int threads;					// Worker threads (0 = one per processor)
+	int cache;						// Use a binary cache of the parsed data file, saved alongside it
+	int index;						// Use a seek index of the data file, saved alongside it
+	int pipeline;					// Read, parse and accumulate the data on separate threads
+	int sortMemory;					// Memory budget (MB) for sorting the data rows, from the first found out of order (0 = not sorted)
+	int stream;						// Read the times as the data reaches them, and write each row once the data has passed its interval
+	int follow;						// Keep reading the data file as it grows (streaming), until interrupted
+	const char *checkpoint;			// Checkpoint file of the results so far, to resume from once the data file has grown
+	int quiet;						// Do not report each file opened and saved (only warnings and errors)
 } omsummary_settings_t;
 
+// Summarize a data file in to the intervals of a times file, writing the output file (as configured by the settings), returns 0 if successful
 int OmSummaryRun(omsummary_settings_t *settings);
 
+
+// Summarizer of events (held in memory by the caller) in to labelled intervals
+typedef struct omsummary_tag omsummary_t;
+
+// Summary of an interval (times are ticks since the epoch, see timestamp.h)
+typedef struct
+{
+	const char *label;				// Label (valid until another interval is added, or the summarizer is freed)
+	timestamp_t start;				// Start of the interval
+	timestamp_t end;				// End of the interval
+	timestamp_t first;				// Earliest time of the events within the interval (when count > 0)
+	timestamp_t last;				// Latest time of the events within the interval (when count > 0)
+	timestamp_t duration;			// Sum of the events' time within the interval
+	int count;						// Number of events overlapping the interval
+} omsummary_result_t;
+
+// Initialize the settings to their defaults
+void OmSummarySettingsInit(omsummary_settings_t *settings);
+
+// Create a summarizer, using the output and sorting settings (NULL for the defaults; any strings must remain valid), returns NULL if out of memory
+omsummary_t *OmSummaryCreate(const omsummary_settings_t *settings);
+
+// Add an interval (all intervals must be added before the first event), returns false if out of memory, the interval is negative, or events have been added
+bool OmSummaryAddInterval(omsummary_t *summary, const char *label, timestamp_t start, timestamp_t end);
+
+// Add the intervals of a times file, returns false if there was a problem with the file, or events have been added
+bool OmSummaryAddTimesFile(omsummary_t *summary, const char *timesFilename);
+
+// Add an event, as a row of the data file: the time from start to end is accumulated in to the intervals, returns false if there was a problem
+bool OmSummaryAddEvent(omsummary_t *summary, timestamp_t start, timestamp_t end);
+
+// Add a batch of events as arrays, returns false if there was a problem
+bool OmSummaryAddEvents(omsummary_t *summary, size_t count, const timestamp_t *start, const timestamp_t *end);
+
+// Number of intervals
+int OmSummaryCount(omsummary_t *summary);
+
+// Get the summary of an interval (in the order added), accumulating any events still being sorted, returns false if there is no such interval
+bool OmSummaryResult(omsummary_t *summary, int index, omsummary_result_t *result);
+
+// Write the summary (as the output file of OmSummaryRun()), returns false if there was an error
+bool OmSummaryWrite(omsummary_t *summary, FILE *fp);
+
+// Free a summarizer
+void OmSummaryFree(omsummary_t *summary);
+
 #endif
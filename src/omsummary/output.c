@@ -0,0 +1,347 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Buffered Output
+// Dan Jackson
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#else
+#define _DEFAULT_SOURCE		// fileno()
+#include <unistd.h>
+#include <sys/uio.h>
+#endif
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "output.h"
+
+
+// Two-digit decimal strings
+static const char outputDigits[] =
+	"00010203040506070809" "10111213141516171819" "20212223242526272829" "30313233343536373839" "40414243444546474849"
+	"50515253545556575859" "60616263646566676869" "70717273747576777879" "80818283848586878889" "90919293949596979899";
+
+static const uint64_t outputPowers[] = { 1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL };
+
+
+// Initialize buffered output to a file (or to memory only, if NULL)
+void OutputInit(output_t *output, FILE *fp)
+{
+	memset(output, 0, sizeof(output_t));
+	output->fp = fp;
+}
+
+
+// Write whole blocks directly to the file's descriptor, bypassing the stdio buffer (only for a file that has a descriptor, not e.g. a memory stream)
+void OutputDirect(output_t *output)
+{
+#ifndef _WIN32
+	output->direct = true;
+#endif
+}
+
+
+// Reserve space for at least the given number of bytes at the end of the buffer (flushing when writing to a file)
+char *OutputReserve(output_t *output, size_t length)
+{
+	if (output->length + length > output->capacity)
+	{
+		if (output->fp != NULL && output->length > 0)
+		{
+			OutputFlush(output);
+		}
+		if (output->length + length > output->capacity)
+		{
+			size_t capacity = (output->capacity > 0) ? output->capacity : OUTPUT_BUFFER_SIZE;
+			while (capacity < output->length + length) { capacity *= 2; }
+			char *buffer = (char *)realloc(output->buffer, capacity);
+			if (buffer == NULL)
+			{
+				output->error = true;
+				return NULL;
+			}
+			output->buffer = buffer;
+			output->capacity = capacity;
+		}
+	}
+	return output->buffer + output->length;
+}
+
+
+// Append bytes
+void OutputWrite(output_t *output, const char *data, size_t length)
+{
+	char *p = OutputReserve(output, length);
+	if (p == NULL) { return; }
+	memcpy(p, data, length);
+	output->length += length;
+}
+
+
+// Append a NUL-terminated string
+void OutputString(output_t *output, const char *str)
+{
+	OutputWrite(output, str, strlen(str));
+}
+
+
+// Write the digits of an unsigned value, returns the length
+static int OutputFormatUnsigned(char *buffer, uint64_t value)
+{
+	char digits[20];
+	char *p = digits + sizeof(digits);
+	while (value >= 100)
+	{
+		p -= 2;
+		memcpy(p, outputDigits + 2 * (value % 100), 2);
+		value /= 100;
+	}
+	if (value >= 10)
+	{
+		p -= 2;
+		memcpy(p, outputDigits + 2 * value, 2);
+	}
+	else
+	{
+		*--p = (char)('0' + value);
+	}
+	int length = (int)(digits + sizeof(digits) - p);
+	memcpy(buffer, p, length);
+	return length;
+}
+
+
+// Append a decimal integer
+void OutputInt(output_t *output, int value)
+{
+	char *p = OutputReserve(output, 12);
+	if (p == NULL) { return; }
+	int length = 0;
+	uint64_t magnitude = (uint64_t)(value < 0 ? -(long long)value : value);
+	if (value < 0) { p[length++] = '-'; }
+	length += OutputFormatUnsigned(p + length, magnitude);
+	output->length += length;
+}
+
+
+// Format a fixed-point number (as "%.*f", decimals 0-9), returns the length
+int OutputFormatFixed(char *buffer, double value, int decimals)
+{
+#if defined(__SIZEOF_INT128__)
+	// Exactly round the binary value to the number of decimals (ties to even, as the C library)
+	if (isfinite(value) && decimals >= 0 && decimals <= 9)
+	{
+		uint64_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		bool negative = (bits >> 63) != 0;
+		int exponent = (int)((bits >> 52) & 0x7ff);
+		uint64_t mantissa = bits & ((1ULL << 52) - 1);
+		if (exponent == 0) { exponent = 1; } else { mantissa |= 1ULL << 52; }
+		exponent -= 1075;															// value = mantissa * 2^exponent
+
+		unsigned __int128 scaled = (unsigned __int128)mantissa * outputPowers[decimals];	// < 2^83
+		bool fits = true;
+		if (exponent >= 0)
+		{
+			if (exponent >= 45 || (scaled << exponent) >> 64 != 0) { fits = false; }
+			else { scaled <<= exponent; }
+		}
+		else if (-exponent >= 128)
+		{
+			scaled = 0;																// Less than half
+		}
+		else
+		{
+			int shift = -exponent;
+			unsigned __int128 quotient = scaled >> shift;
+			unsigned __int128 remainder = scaled - (quotient << shift);
+			unsigned __int128 half = (unsigned __int128)1 << (shift - 1);
+			if (remainder > half || (remainder == half && (quotient & 1))) { quotient++; }
+			if (quotient >> 64 != 0) { fits = false; }
+			scaled = quotient;
+		}
+
+		if (fits)
+		{
+			uint64_t rounded = (uint64_t)scaled;
+			uint64_t integer = rounded / outputPowers[decimals];
+			uint64_t fraction = rounded % outputPowers[decimals];
+			int length = 0;
+			if (negative) { buffer[length++] = '-'; }
+			length += OutputFormatUnsigned(buffer + length, integer);
+			if (decimals > 0)
+			{
+				buffer[length++] = '.';
+				for (int i = decimals - 1; i >= 0; i--)
+				{
+					buffer[length + i] = (char)('0' + fraction % 10);
+					fraction /= 10;
+				}
+				length += decimals;
+			}
+			buffer[length] = '\0';
+			return length;
+		}
+	}
+#endif
+	return sprintf(buffer, "%.*f", decimals, value);
+}
+
+
+// Append a fixed-point number (as "%.*f")
+void OutputFixed(output_t *output, double value, int decimals)
+{
+	char *p = OutputReserve(output, OUTPUT_MAX_FIXED);
+	if (p == NULL) { return; }
+	output->length += OutputFormatFixed(p, value, decimals);
+}
+
+
+// Write the buffered output to the file, returns false if there was an error
+bool OutputFlush(output_t *output)
+{
+	if (output->fp == NULL || output->length == 0)
+	{
+		return !output->error;
+	}
+	if (!output->direct)
+	{
+		if (fwrite(output->buffer, 1, output->length, output->fp) != output->length)
+		{
+			output->error = true;
+		}
+		output->length = 0;
+		return !output->error;
+	}
+#ifndef _WIN32
+	// Write whole blocks directly, bypassing the stdio buffer
+	fflush(output->fp);
+	const char *p = output->buffer;
+	size_t remaining = output->length;
+	while (remaining > 0)
+	{
+		ssize_t written = write(fileno(output->fp), p, remaining);
+		if (written < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (written <= 0)
+		{
+			output->error = true;
+			break;
+		}
+		p += written;
+		remaining -= (size_t)written;
+	}
+#endif
+	output->length = 0;
+	return !output->error;
+}
+
+
+// Write several memory-only buffers to an output's file in order (with a single gathered write where possible when direct), emptying them, returns false if there was an error
+bool OutputWriteBuffers(output_t *destination, output_t *outputs, int count)
+{
+	bool ok = true;
+	FILE *fp = destination->fp;
+	if (!destination->direct)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			if (outputs[i].error || fwrite(outputs[i].buffer, 1, outputs[i].length, fp) != outputs[i].length)
+			{
+				ok = false;
+			}
+			outputs[i].length = 0;
+		}
+		return ok;
+	}
+#ifndef _WIN32
+	#define OUTPUT_MAX_IOV 64
+	fflush(fp);
+	for (int first = 0; first < count; first += OUTPUT_MAX_IOV)
+	{
+		struct iovec iov[OUTPUT_MAX_IOV];
+		int numIov = 0;
+		for (int i = first; i < count && i < first + OUTPUT_MAX_IOV; i++)
+		{
+			if (outputs[i].error) { ok = false; }
+			if (outputs[i].length == 0) { continue; }
+			iov[numIov].iov_base = outputs[i].buffer;
+			iov[numIov].iov_len = outputs[i].length;
+			numIov++;
+		}
+
+		// Continue after any partial writes
+		struct iovec *next = iov;
+		while (numIov > 0)
+		{
+			ssize_t written = writev(fileno(fp), next, numIov);
+			if (written < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (written <= 0)
+			{
+				ok = false;
+				break;
+			}
+			while (numIov > 0 && (size_t)written >= next->iov_len)
+			{
+				written -= (ssize_t)next->iov_len;
+				next++;
+				numIov--;
+			}
+			if (numIov > 0)
+			{
+				next->iov_base = (char *)next->iov_base + written;
+				next->iov_len -= (size_t)written;
+			}
+		}
+	}
+	for (int i = 0; i < count; i++)
+	{
+		outputs[i].length = 0;
+	}
+#endif
+	return ok;
+}
+
+
+// Flush and free the buffer, returns false if there was an error
+bool OutputClose(output_t *output)
+{
+	bool ok = OutputFlush(output);
+	free(output->buffer);
+	output->buffer = NULL;
+	output->length = 0;
+	output->capacity = 0;
+	return ok;
+}
@@ -0,0 +1,76 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Buffered Output
+// Dan Jackson
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define OUTPUT_BUFFER_SIZE (256 * 1024)		// Size of the block written to a file at once
+
+typedef struct
+{
+	FILE *fp;							// Destination file (NULL to only buffer in memory)
+	char *buffer;						// Buffered output
+	size_t length;						// Length of the buffered output
+	size_t capacity;					// Allocated buffer size
+	bool error;							// A write or allocation has failed
+	bool direct;						// Write to the file's descriptor, bypassing the stdio buffer
+} output_t;
+
+// Initialize buffered output to a file (or to memory only, if NULL)
+void OutputInit(output_t *output, FILE *fp);
+
+// Write whole blocks directly to the file's descriptor, bypassing the stdio buffer (only for a file that has a descriptor, not e.g. a memory stream)
+void OutputDirect(output_t *output);
+
+// Reserve space for at least the given number of bytes at the end of the buffer (flushing when writing to a file), the caller adds the number of bytes used to the length (NULL on allocation failure)
+char *OutputReserve(output_t *output, size_t length);
+
+// Append bytes, a NUL-terminated string, a decimal integer, or a fixed-point number (as "%.*f")
+void OutputWrite(output_t *output, const char *data, size_t length);
+void OutputString(output_t *output, const char *str);
+void OutputInt(output_t *output, int value);
+void OutputFixed(output_t *output, double value, int decimals);
+
+// Format a fixed-point number (as "%.*f", decimals 0-9) in to a buffer of at least OUTPUT_MAX_FIXED bytes, returns the length
+#define OUTPUT_MAX_FIXED 352
+int OutputFormatFixed(char *buffer, double value, int decimals);
+
+// Write the buffered output to the file, returns false if there was an error
+bool OutputFlush(output_t *output);
+
+// Write several memory-only buffers to an output's file in order (with a single gathered write where possible when direct), emptying them, returns false if there was an error
+bool OutputWriteBuffers(output_t *destination, output_t *outputs, int count);
+
+// Flush and free the buffer, returns false if there was an error
+bool OutputClose(output_t *output);
+
+#endif
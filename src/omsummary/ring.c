@@ -0,0 +1,134 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Single-Producer Single-Consumer Ring Buffer
+// Dan Jackson
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#include <windows.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ring.h"
+#include "thread.h"
+
+// Position loads and stores: the consumer must see an item before the position that publishes it (and the producer must see a slot is free before reusing it)
+#if defined(_MSC_VER)
+#define RING_LOAD_ACQUIRE(_p) (*(volatile size_t *)(_p))					// MSVC volatile accesses have acquire/release semantics (/volatile:ms)
+#define RING_STORE_RELEASE(_p, _v) (*(volatile size_t *)(_p) = (_v))
+#else
+#define RING_LOAD_ACQUIRE(_p) __atomic_load_n((_p), __ATOMIC_ACQUIRE)
+#define RING_STORE_RELEASE(_p, _v) __atomic_store_n((_p), (_v), __ATOMIC_RELEASE)
+#endif
+
+// Waiting: spin briefly, then yield, then sleep (so that a stalled stage does not occupy a processor)
+#define RING_SPIN 64
+#define RING_YIELD 1024
+
+
+// Initialize a ring with space for at least the given number of items, returns false if out of memory
+bool RingInit(ring_t *ring, size_t capacity)
+{
+	memset(ring, 0, sizeof(ring_t));
+	size_t size = 1;
+	while (size < capacity) { size <<= 1; }
+	ring->items = (void **)calloc(size, sizeof(void *));
+	if (ring->items == NULL)
+	{
+		return false;
+	}
+	ring->mask = size - 1;
+	return true;
+}
+
+
+// Producer: add an item, returns false if the ring is full
+bool RingPush(ring_t *ring, void *item)
+{
+	size_t head = ring->head;
+	if (head - RING_LOAD_ACQUIRE(&ring->tail) > ring->mask)
+	{
+		return false;
+	}
+	ring->items[head & ring->mask] = item;
+	RING_STORE_RELEASE(&ring->head, head + 1);
+	return true;
+}
+
+
+// Consumer: remove the oldest item, returns NULL if the ring is empty
+void *RingPop(ring_t *ring)
+{
+	size_t tail = ring->tail;
+	if (tail == RING_LOAD_ACQUIRE(&ring->head))
+	{
+		return NULL;
+	}
+	void *item = ring->items[tail & ring->mask];
+	RING_STORE_RELEASE(&ring->tail, tail + 1);
+	return item;
+}
+
+
+// Back off while waiting for the other thread
+static void RingWait(int attempt)
+{
+	if (attempt < RING_SPIN) { return; }
+	if (attempt < RING_YIELD) { ThreadYield(); return; }
+	ThreadSleep(1);
+}
+
+
+// Producer: add an item, waiting while the ring is full
+void RingPushWait(ring_t *ring, void *item)
+{
+	for (int attempt = 0; !RingPush(ring, item); attempt += (attempt <= RING_YIELD))
+	{
+		RingWait(attempt);
+	}
+}
+
+
+// Consumer: remove the oldest item, waiting while the ring is empty
+void *RingPopWait(ring_t *ring)
+{
+	void *item;
+	for (int attempt = 0; (item = RingPop(ring)) == NULL; attempt += (attempt <= RING_YIELD))
+	{
+		RingWait(attempt);
+	}
+	return item;
+}
+
+
+// Free a ring
+void RingFree(ring_t *ring)
+{
+	free(ring->items);
+	memset(ring, 0, sizeof(ring_t));
+}
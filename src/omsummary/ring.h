@@ -0,0 +1,65 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Single-Producer Single-Consumer Ring Buffer
+// Dan Jackson
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Bounded queue of (non-NULL) pointers, passed without locks from one producer thread to one consumer thread
+typedef struct
+{
+	void **items;					// Item storage
+	size_t mask;					// Capacity - 1 (the capacity is a power of two)
+	char padding0[64];				// (the producer and consumer positions are on separate cache lines)
+	size_t head;					// Count of items pushed (only written by the producer)
+	char padding1[64];
+	size_t tail;					// Count of items popped (only written by the consumer)
+	char padding2[64];
+} ring_t;
+
+// Initialize a ring with space for at least the given number of items, returns false if out of memory
+bool RingInit(ring_t *ring, size_t capacity);
+
+// Producer: add an item, returns false if the ring is full
+bool RingPush(ring_t *ring, void *item);
+
+// Consumer: remove the oldest item, returns NULL if the ring is empty
+void *RingPop(ring_t *ring);
+
+// Producer: add an item, waiting while the ring is full
+void RingPushWait(ring_t *ring, void *item);
+
+// Consumer: remove the oldest item, waiting while the ring is empty
+void *RingPopWait(ring_t *ring);
+
+// Free a ring
+void RingFree(ring_t *ring);
+
+#endif
@@ -0,0 +1,240 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// External Sort of Parsed Events
+// Dan Jackson
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#else
+#define _DEFAULT_SOURCE		// fseeko()
+#endif
+#include <sys/types.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sort.h"
+
+// A spilled run being merged: a buffer of its events read from the temporary file
+typedef struct
+{
+	sort_event_t *events;			// Buffered events
+	size_t numEvents;				// Number of buffered events
+	size_t next;					// Next buffered event
+	size_t remaining;				// Events of the run not yet buffered
+	size_t offset;					// File offset of the events not yet buffered
+} sort_run_t;
+
+
+// Compare events by start, then by end
+static int EventSortCompare(const void *a, const void *b)
+{
+	const sort_event_t *ea = (const sort_event_t *)a;
+	const sort_event_t *eb = (const sort_event_t *)b;
+	if (ea->start != eb->start) { return (ea->start < eb->start) ? -1 : 1; }
+	if (ea->end != eb->end) { return (ea->end < eb->end) ? -1 : 1; }
+	return 0;
+}
+
+
+// Start sorting events within a memory budget (bytes), returns false if out of memory
+bool EventSortInit(event_sort_t *sort, size_t memory)
+{
+	memset(sort, 0, sizeof(event_sort_t));
+	if (memory < EVENT_SORT_MIN_MEMORY) { memory = EVENT_SORT_MIN_MEMORY; }
+	sort->capacity = memory / sizeof(sort_event_t);
+	sort->events = (sort_event_t *)malloc(sort->capacity * sizeof(sort_event_t));
+	return sort->events != NULL;
+}
+
+
+// Sort the current run and append it to the temporary file, returns false if there was a problem
+static bool EventSortSpill(event_sort_t *sort)
+{
+	if (sort->numRuns + 1 > sort->capacityRuns)
+	{
+		size_t capacity = 15 * sort->capacityRuns / 10 + 16;	// Grow by ~1.5x
+		size_t *runLength = (size_t *)realloc(sort->runLength, capacity * sizeof(size_t));
+		if (runLength == NULL) { return false; }
+		sort->runLength = runLength;
+		sort->capacityRuns = capacity;
+	}
+	if (sort->fp == NULL && (sort->fp = tmpfile()) == NULL)
+	{
+		return false;
+	}
+	qsort(sort->events, sort->numEvents, sizeof(sort_event_t), EventSortCompare);
+	if (fwrite(sort->events, sizeof(sort_event_t), sort->numEvents, sort->fp) != sort->numEvents)
+	{
+		return false;
+	}
+	sort->runLength[sort->numRuns++] = sort->numEvents;
+	sort->numEvents = 0;
+	return true;
+}
+
+
+// Add an event, returns false if there was a problem spilling a run (the event is not added)
+bool EventSortAdd(event_sort_t *sort, timestamp_t start, timestamp_t end)
+{
+	if (sort->numEvents >= sort->capacity && !EventSortSpill(sort))
+	{
+		return false;
+	}
+	sort->events[sort->numEvents].start = start;
+	sort->events[sort->numEvents].end = end;
+	sort->numEvents++;
+	return true;
+}
+
+
+// Buffer the next events of a run from the temporary file, returns false if there was a problem
+static bool EventSortRead(event_sort_t *sort, sort_run_t *run, size_t capacity)
+{
+	size_t count = (run->remaining < capacity) ? run->remaining : capacity;
+#ifdef _WIN32
+	int seek = _fseeki64(sort->fp, (__int64)run->offset, SEEK_SET);
+#else
+	int seek = fseeko(sort->fp, (off_t)run->offset, SEEK_SET);
+#endif
+	if (seek != 0 || fread(run->events, sizeof(sort_event_t), count, sort->fp) != count)
+	{
+		return false;
+	}
+	run->numEvents = count;
+	run->next = 0;
+	run->remaining -= count;
+	run->offset += count * sizeof(sort_event_t);
+	return true;
+}
+
+
+// Restore the heap order (by each run's next event) below a position
+static void EventSortSiftDown(sort_run_t **heap, size_t count, size_t i)
+{
+	for (;;)
+	{
+		size_t smallest = i;
+		size_t left = 2 * i + 1, right = 2 * i + 2;
+		if (left < count && EventSortCompare(&heap[left]->events[heap[left]->next], &heap[smallest]->events[heap[smallest]->next]) < 0) { smallest = left; }
+		if (right < count && EventSortCompare(&heap[right]->events[heap[right]->next], &heap[smallest]->events[heap[smallest]->next]) < 0) { smallest = right; }
+		if (smallest == i)
+		{
+			break;
+		}
+		sort_run_t *swap = heap[i]; heap[i] = heap[smallest]; heap[smallest] = swap;
+		i = smallest;
+	}
+}
+
+
+// Output all of the events in order (merging any spilled runs), returns false if there was a problem with the temporary file
+bool EventSortFinish(event_sort_t *sort, event_sort_output_t output, void *context)
+{
+	// Everything fitted in memory
+	if (sort->numRuns == 0)
+	{
+		qsort(sort->events, sort->numEvents, sizeof(sort_event_t), EventSortCompare);
+		for (size_t i = 0; i < sort->numEvents; i++)
+		{
+			output(context, sort->events[i].start, sort->events[i].end);
+		}
+		sort->numEvents = 0;
+		return true;
+	}
+
+	// Spill the last run, then share the memory budget between the runs' read buffers
+	if (sort->numEvents > 0 && !EventSortSpill(sort))
+	{
+		return false;
+	}
+	free(sort->events);
+	sort->events = NULL;
+	size_t capacity = sort->capacity / sort->numRuns;
+	if (capacity < EVENT_SORT_MIN_READ) { capacity = EVENT_SORT_MIN_READ; }
+	sort_run_t *runs = (sort_run_t *)calloc(sort->numRuns, sizeof(sort_run_t));
+	sort_run_t **heap = (sort_run_t **)malloc(sort->numRuns * sizeof(sort_run_t *));
+	sort_event_t *buffers = (sort_event_t *)malloc(sort->numRuns * capacity * sizeof(sort_event_t));
+	bool ok = (runs != NULL && heap != NULL && buffers != NULL);
+
+	// Fill each run's buffer
+	size_t count = 0;
+	size_t offset = 0;
+	for (size_t r = 0; ok && r < sort->numRuns; r++)
+	{
+		sort_run_t *run = &runs[r];
+		run->events = buffers + r * capacity;
+		run->remaining = sort->runLength[r];
+		run->offset = offset;
+		offset += sort->runLength[r] * sizeof(sort_event_t);
+		ok = EventSortRead(sort, run, capacity);
+		if (run->numEvents > 0)
+		{
+			heap[count++] = run;
+		}
+	}
+	for (size_t i = count; ok && i-- > 0; )
+	{
+		EventSortSiftDown(heap, count, i);
+	}
+
+	// Repeatedly output the earliest next event of all of the runs
+	while (ok && count > 0)
+	{
+		sort_run_t *run = heap[0];
+		output(context, run->events[run->next].start, run->events[run->next].end);
+		if (++run->next >= run->numEvents)
+		{
+			if (run->remaining > 0)
+			{
+				ok = EventSortRead(sort, run, capacity);
+			}
+			else
+			{
+				heap[0] = heap[--count];
+			}
+		}
+		EventSortSiftDown(heap, count, 0);
+	}
+
+	free(buffers);
+	free(heap);
+	free(runs);
+	return ok;
+}
+
+
+// Free the sort (and remove its temporary file)
+void EventSortFree(event_sort_t *sort)
+{
+	if (sort->fp != NULL)
+	{
+		fclose(sort->fp);
+	}
+	free(sort->runLength);
+	free(sort->events);
+	memset(sort, 0, sizeof(event_sort_t));
+}
@@ -0,0 +1,75 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// External Sort of Parsed Events
+// Dan Jackson
+
+#ifndef SORT_H
+#define SORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "timestamp.h"
+
+#define EVENT_SORT_MIN_MEMORY (1024 * 1024)	// Smallest memory budget
+#define EVENT_SORT_MIN_READ 1024				// Fewest events read at a time from each run while merging
+
+// An event being sorted
+typedef struct
+{
+	timestamp_t start;
+	timestamp_t end;
+} sort_event_t;
+
+// Sorts events in to start order within a memory budget: runs of events that fill the budget are sorted and spilled to a temporary file, then merged
+typedef struct
+{
+	sort_event_t *events;			// Events of the current run
+	size_t numEvents;				// Number of events in the current run
+	size_t capacity;				// Events in the memory budget
+	FILE *fp;						// Temporary file of spilled runs (one after another)
+	size_t *runLength;				// Number of events in each spilled run
+	size_t numRuns;					// Number of spilled runs
+	size_t capacityRuns;
+} event_sort_t;
+
+// Called with each event, in order
+typedef void (*event_sort_output_t)(void *context, timestamp_t start, timestamp_t end);
+
+// Start sorting events within a memory budget (bytes), returns false if out of memory
+bool EventSortInit(event_sort_t *sort, size_t memory);
+
+// Add an event, returns false if there was a problem spilling a run (the event is not added)
+bool EventSortAdd(event_sort_t *sort, timestamp_t start, timestamp_t end);
+
+// Output all of the events in order (merging any spilled runs), returns false if there was a problem with the temporary file
+bool EventSortFinish(event_sort_t *sort, event_sort_output_t output, void *context);
+
+// Free the sort (and remove its temporary file)
+void EventSortFree(event_sort_t *sort);
+
+#endif
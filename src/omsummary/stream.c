@@ -0,0 +1,161 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Stream Reader Thread
+// Dan Jackson
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "stream.h"
+
+
+// Reader thread: fill empty blocks from the stream until the end of the stream
+static void *StreamReaderThread(void *arg)
+{
+	stream_reader_t *reader = (stream_reader_t *)arg;
+	for (;;)
+	{
+		stream_block_t *block = (stream_block_t *)RingPopWait(&reader->empty);
+		block->length = fread(block->data, 1, STREAM_BLOCK_SIZE, reader->fp);
+		RingPushWait(&reader->full, block);
+		if (block->length == 0)
+		{
+			break;
+		}
+	}
+	return NULL;
+}
+
+
+// Free the reader's storage
+static void StreamReaderFree(stream_reader_t *reader)
+{
+	if (reader->blocks != NULL)
+	{
+		for (int i = 0; i < STREAM_BLOCKS; i++)
+		{
+			free(reader->blocks[i].data);
+		}
+		free(reader->blocks);
+	}
+	RingFree(&reader->full);
+	RingFree(&reader->empty);
+	memset(reader, 0, sizeof(stream_reader_t));
+}
+
+
+// Start a thread reading a stream, returns false if it could not be started
+bool StreamReaderStart(stream_reader_t *reader, FILE *fp)
+{
+	memset(reader, 0, sizeof(stream_reader_t));
+	reader->fp = fp;
+	reader->blocks = (stream_block_t *)calloc(STREAM_BLOCKS, sizeof(stream_block_t));
+	if (reader->blocks == NULL || !RingInit(&reader->full, STREAM_BLOCKS) || !RingInit(&reader->empty, STREAM_BLOCKS))
+	{
+		StreamReaderFree(reader);
+		return false;
+	}
+	for (int i = 0; i < STREAM_BLOCKS; i++)
+	{
+		reader->blocks[i].data = (char *)malloc(STREAM_BLOCK_SIZE);
+		if (reader->blocks[i].data == NULL)
+		{
+			StreamReaderFree(reader);
+			return false;
+		}
+		RingPush(&reader->empty, &reader->blocks[i]);
+	}
+	if (!ThreadCreate(&reader->thread, StreamReaderThread, reader))
+	{
+		StreamReaderFree(reader);
+		return false;
+	}
+	return true;
+}
+
+
+// Consumer: read up to size bytes in to the buffer (from one block at a time), waiting for data, returns the number of bytes read (0 at the end of the stream), usable as a csv_read_t
+size_t StreamRead(void *context, void *buffer, size_t size)
+{
+	stream_reader_t *reader = (stream_reader_t *)context;
+	size_t count = 0;
+	while (count == 0 && size > 0 && !reader->eof)
+	{
+		// Next block
+		if (reader->current == NULL)
+		{
+			reader->current = (stream_block_t *)RingPopWait(&reader->full);
+			reader->offset = 0;
+			if (reader->current->length == 0)
+			{
+				reader->eof = true;
+				break;
+			}
+		}
+
+		size_t length = reader->current->length - reader->offset;
+		if (length > size) { length = size; }
+		memcpy(buffer, reader->current->data + reader->offset, length);
+		count = length;
+		reader->offset += length;
+
+		// Return a consumed block to the reader thread
+		if (reader->offset >= reader->current->length)
+		{
+			RingPushWait(&reader->empty, reader->current);
+			reader->current = NULL;
+		}
+	}
+	return count;
+}
+
+
+// Consume any remaining data, wait for the reader thread to finish, and free the reader (the stream is not closed)
+void StreamReaderStop(stream_reader_t *reader)
+{
+	if (reader->blocks == NULL)
+	{
+		return;
+	}
+	while (!reader->eof)
+	{
+		if (reader->current != NULL)
+		{
+			RingPushWait(&reader->empty, reader->current);
+		}
+		reader->current = (stream_block_t *)RingPopWait(&reader->full);
+		if (reader->current->length == 0)
+		{
+			reader->eof = true;
+		}
+	}
+	ThreadJoin(&reader->thread);
+	StreamReaderFree(reader);
+}
@@ -0,0 +1,71 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Stream Reader Thread
+// Dan Jackson
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "ring.h"
+#include "thread.h"
+
+#define STREAM_BLOCK_SIZE (1024 * 1024)	// Bytes read at a time
+#define STREAM_BLOCKS 4					// Blocks in flight between the reader thread and the consumer
+
+// A block of data read from the stream (a zero length marks the end of the stream)
+typedef struct
+{
+	char *data;
+	size_t length;
+} stream_block_t;
+
+// Reads a file (or stdin, or a pipe) in large blocks on its own thread, passed to a consumer on another thread
+typedef struct
+{
+	FILE *fp;						// Stream being read
+	thread_t thread;				// Reader thread
+	stream_block_t *blocks;			// Block storage
+	ring_t full;					// Blocks read, from the reader thread to the consumer
+	ring_t empty;					// Blocks to fill, from the consumer to the reader thread
+	stream_block_t *current;		// Consumer's current block
+	size_t offset;					// Consumer's offset in the current block
+	bool eof;						// The consumer has reached the end of the stream
+} stream_reader_t;
+
+// Start a thread reading a stream, returns false if it could not be started
+bool StreamReaderStart(stream_reader_t *reader, FILE *fp);
+
+// Consumer: read up to size bytes in to the buffer (from one block at a time), waiting for data, returns the number of bytes read (0 at the end of the stream), usable as a csv_read_t
+size_t StreamRead(void *reader, void *buffer, size_t size);
+
+// Consume any remaining data, wait for the reader thread to finish, and free the reader (the stream is not closed)
+void StreamReaderStop(stream_reader_t *reader);
+
+#endif
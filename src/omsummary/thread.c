@@ -0,0 +1,153 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Threads
+// Dan Jackson
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#else
+#define _DEFAULT_SOURCE		// sysconf(_SC_NPROCESSORS_ONLN), usleep()
+#include <unistd.h>
+#include <sched.h>
+#endif
+
+#include "thread.h"
+
+
+#ifdef _WIN32
+static DWORD WINAPI ThreadStart(LPVOID param)
+{
+	thread_t *thread = (thread_t *)param;
+	thread->function(thread->arg);
+	return 0;
+}
+#endif
+
+
+// Start a thread running a function, returns false if the thread could not be created
+bool ThreadCreate(thread_t *thread, void *(*function)(void *arg), void *arg)
+{
+	thread->function = function;
+	thread->arg = arg;
+#ifdef _WIN32
+	thread->handle = CreateThread(NULL, 0, ThreadStart, thread, 0, NULL);
+	return thread->handle != NULL;
+#else
+	return pthread_create(&thread->handle, NULL, function, arg) == 0;
+#endif
+}
+
+
+// Wait for a thread to finish
+void ThreadJoin(thread_t *thread)
+{
+#ifdef _WIN32
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#else
+	pthread_join(thread->handle, NULL);
+#endif
+}
+
+
+// Number of processors available
+int ThreadProcessorCount(void)
+{
+#ifdef _WIN32
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	return (int)systemInfo.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0) ? (int)count : 1;
+#endif
+}
+
+
+// Give up the rest of this thread's time slice
+void ThreadYield(void)
+{
+#ifdef _WIN32
+	SwitchToThread();
+#else
+	sched_yield();
+#endif
+}
+
+
+// Suspend this thread for a number of milliseconds
+void ThreadSleep(int milliseconds)
+{
+#ifdef _WIN32
+	Sleep(milliseconds);
+#else
+	usleep((useconds_t)milliseconds * 1000);
+#endif
+}
+
+
+// Initialize a mutex
+void ThreadMutexInit(thread_mutex_t *mutex)
+{
+#ifdef _WIN32
+	InitializeCriticalSection(&mutex->criticalSection);
+#else
+	pthread_mutex_init(&mutex->mutex, NULL);
+#endif
+}
+
+
+// Lock a mutex
+void ThreadMutexLock(thread_mutex_t *mutex)
+{
+#ifdef _WIN32
+	EnterCriticalSection(&mutex->criticalSection);
+#else
+	pthread_mutex_lock(&mutex->mutex);
+#endif
+}
+
+
+// Unlock a mutex
+void ThreadMutexUnlock(thread_mutex_t *mutex)
+{
+#ifdef _WIN32
+	LeaveCriticalSection(&mutex->criticalSection);
+#else
+	pthread_mutex_unlock(&mutex->mutex);
+#endif
+}
+
+
+// Free a mutex
+void ThreadMutexDestroy(thread_mutex_t *mutex)
+{
+#ifdef _WIN32
+	DeleteCriticalSection(&mutex->criticalSection);
+#else
+	pthread_mutex_destroy(&mutex->mutex);
+#endif
+}
@@ -0,0 +1,87 @@
+/*
+* Copyright Newcastle University, UK.
+* All rights reserved.
+*
+* Redistribution and use in source and binary forms, with or without
+* modification, are permitted provided that the following conditions are met:
+* 1. Redistributions of source code must retain the above copyright notice,
+*    this list of conditions and the following disclaimer.
+* 2. Redistributions in binary form must reproduce the above copyright notice,
+*    this list of conditions and the following disclaimer in the documentation
+*    and/or other materials provided with the distribution.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+* AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+* IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+* ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+* LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+* CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+* SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+* INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+* CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+* ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+* POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Threads
+// Dan Jackson
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <stdbool.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+typedef struct
+{
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+	void *(*function)(void *arg);		// Thread function
+	void *arg;							// Thread function argument
+} thread_t;
+
+typedef struct
+{
+#ifdef _WIN32
+	CRITICAL_SECTION criticalSection;
+#else
+	pthread_mutex_t mutex;
+#endif
+} thread_mutex_t;
+
+// Start a thread running a function, returns false if the thread could not be created
+bool ThreadCreate(thread_t *thread, void *(*function)(void *arg), void *arg);
+
+// Wait for a thread to finish
+void ThreadJoin(thread_t *thread);
+
+// Number of processors available
+int ThreadProcessorCount(void);
+
+// Give up the rest of this thread's time slice
+void ThreadYield(void);
+
+// Suspend this thread for a number of milliseconds
+void ThreadSleep(int milliseconds);
+
+// Initialize a mutex
+void ThreadMutexInit(thread_mutex_t *mutex);
+
+// Lock a mutex
+void ThreadMutexLock(thread_mutex_t *mutex);
+
+// Unlock a mutex
+void ThreadMutexUnlock(thread_mutex_t *mutex);
+
+// Free a mutex
+void ThreadMutexDestroy(thread_mutex_t *mutex);
+
+#endif
@@ -42,6 +42,7 @@
 #include <sys/timeb.h>
 
 #include "timestamp.h"
+#include "numeric.h"
 
 
 // Returns the number of seconds since the epoch
@@ -58,16 +59,134 @@ char *TimeString(double t, char *buff)
 {
 	static char staticBuffer[TIME_MAX_STRING] = { 0 };	// "2000-01-01 20:00:00.000|"
 	if (buff == NULL) { buff = staticBuffer; }			// Static buffer is not thread safe
-	time_t tn = (time_t)t;
-	struct tm *tmn = gmtime(&tn);
-	float sec = tmn->tm_sec + (float)(t - (time_t)t);
-	sprintf(buff, "%04d-%02d-%02d %02d:%02d:%02d.%03d", 1900 + tmn->tm_year, tmn->tm_mon + 1, tmn->tm_mday, tmn->tm_hour, tmn->tm_min, (int)sec, (int)((sec - (int)sec) * 1000));
+	TimeFormat(NULL, TimeSecondsToTicks(t), buff);
 	return buff;
 }
 
 
-// Parse a string time representation ("YYYY-MM-DD hh:mm:ss.fff") in to seconds since the epoch
-double TimeParse(const char *timeString)
+// Days since the epoch for a (proleptic Gregorian) civil date, valid for year >= 0
+static long TimeDaysFromCivil(int year, int month, int day)
+{
+	year -= (month <= 2);
+	int era = year / 400;
+	int yearOfEra = year - era * 400;													// [0, 399]
+	int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;			// [0, 365], from March 1st
+	int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;		// [0, 146096]
+	return (long)era * 146097 + dayOfEra - 719468;
+}
+
+
+// Little-endian load of 8 bytes
+static unsigned long long TimeLoad8(const char *p)
+{
+	const unsigned char *b = (const unsigned char *)p;
+	return (unsigned long long)b[0] | ((unsigned long long)b[1] << 8) | ((unsigned long long)b[2] << 16) | ((unsigned long long)b[3] << 24)
+		| ((unsigned long long)b[4] << 32) | ((unsigned long long)b[5] << 40) | ((unsigned long long)b[6] << 48) | ((unsigned long long)b[7] << 56);
+}
+
+
+// Check 8 bytes are all digits where set in the mask, and subtract the '0' from them
+static int TimeDigits8(unsigned long long *value, unsigned long long digitMask)
+{
+	unsigned long long zeros = 0x3030303030303030ULL & digitMask;
+	unsigned long long x = *value & digitMask;
+	if ((x & 0xF0F0F0F0F0F0F0F0ULL) != zeros) { return 0; }								// 0x30-0x3f
+	if (((x + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) != zeros) { return 0; }	// 0x30-0x39 (no carries as all bytes are < 0x40)
+	*value = x - zeros;
+	return 1;
+}
+
+#define TIME_DIGIT(_value, _index) ((int)(((_value) >> (8 * (_index))) & 0xff))
+
+
+// Parse the exact fixed layout "YYYY-MM-DD hh:mm:ss[.fffff]" (or 'T' separator), returns 0 if the string does not match
+static int TimeParseFixed(time_parser_t *parser, const char *timeString, size_t length, timestamp_t *result)
+{
+	static const timestamp_t powers[] = { 1, 10, 100, 1000, 10000, 100000 };
+
+	// Length for seconds and up to 5 fractional digits (longer fractions are left to the tolerant parser)
+	if (length < 19 || length == 20 || length > 20 + sizeof(powers) / sizeof(powers[0]) - 1) { return 0; }
+
+	// "DD hh:mm": digits, ' ' or 'T', and ':' separators
+	unsigned long long time = TimeLoad8(timeString + 8);
+	unsigned long long separators = time & 0x0000FF0000FF0000ULL;
+	if (separators != 0x00003A0000200000ULL && separators != 0x00003A0000540000ULL) { return 0; }
+	if (!TimeDigits8(&time, 0xFFFF00FFFF00FFFFULL)) { return 0; }
+
+	// ":ss"
+	const char *p = timeString + 16;
+	if (p[0] != ':' || (unsigned)(p[1] - '0') > 9 || (unsigned)(p[2] - '0') > 9) { return 0; }
+
+	int hours = TIME_DIGIT(time, 3) * 10 + TIME_DIGIT(time, 4);
+	int minutes = TIME_DIGIT(time, 6) * 10 + TIME_DIGIT(time, 7);
+	int seconds = (p[1] - '0') * 10 + (p[2] - '0');
+
+	// Out of range values are left to the tolerant parser to report
+	if (hours > 23 || minutes > 59 || seconds > 59) { return 0; }
+
+	// Optional ".fffff", to the nearest tick
+	timestamp_t fraction = 0;
+	if (length > 19)
+	{
+		if (timeString[19] != '.') { return 0; }
+		int value = 0;
+		for (size_t i = 20; i < length; i++)
+		{
+			unsigned digit = (unsigned)(timeString[i] - '0');
+			if (digit > 9) { return 0; }
+			value = value * 10 + (int)digit;
+		}
+		timestamp_t power = powers[length - 20];
+		fraction = ((timestamp_t)value * TIME_TICKS_PER_SECOND * 2 + power) / (2 * power);
+	}
+
+	// The date is usually the same as a recent one
+	long long midnight = 0;
+	int hit = 0;
+	if (parser != NULL)
+	{
+		for (int i = 0; i < TIME_PARSER_CACHE; i++)
+		{
+			if (parser->cache[i].valid && memcmp(parser->cache[i].date, timeString, sizeof(parser->cache[i].date)) == 0)
+			{
+				midnight = parser->cache[i].midnight;
+				hit = 1;
+				break;
+			}
+		}
+	}
+
+	if (!hit)
+	{
+		// "YYYY-MM-": digits and '-' separators
+		unsigned long long date = TimeLoad8(timeString);
+		if ((date & 0xFF0000FF00000000ULL) != 0x2D00002D00000000ULL) { return 0; }
+		if (!TimeDigits8(&date, 0x00FFFF00FFFFFFFFULL)) { return 0; }
+
+		int year = TIME_DIGIT(date, 0) * 1000 + TIME_DIGIT(date, 1) * 100 + TIME_DIGIT(date, 2) * 10 + TIME_DIGIT(date, 3);
+		int month = TIME_DIGIT(date, 5) * 10 + TIME_DIGIT(date, 6);
+		int day = TIME_DIGIT(time, 0) * 10 + TIME_DIGIT(time, 1);
+		if ((unsigned)(year - 1900) > 200 || (unsigned)(month - 1) > 11 || (unsigned)(day - 1) > 30) { return 0; }
+
+		midnight = (long long)TimeDaysFromCivil(year, month, day) * 86400;
+
+		// Remember the date, replacing the oldest entry
+		if (parser != NULL)
+		{
+			memcpy(parser->cache[parser->next].date, timeString, sizeof(parser->cache[parser->next].date));
+			parser->cache[parser->next].midnight = midnight;
+			parser->cache[parser->next].valid = 1;
+			parser->next = (parser->next + 1) % TIME_PARSER_CACHE;
+		}
+	}
+
+	*result = (midnight + hours * 3600 + minutes * 60 + seconds) * (timestamp_t)TIME_TICKS_PER_SECOND + fraction;
+	return 1;
+}
+
+
+// Parse a string time representation in to ticks since the epoch, tolerant of any non-digit separators
+static timestamp_t TimeParseTolerant(const char *timeString, size_t length)
 {
 	int index = 0;
 	char *token = NULL;
@@ -80,7 +199,7 @@ double TimeParse(const char *timeString)
 
 	//strcpy_s(tstr, sizeof(tstr), timeString);
 	{
-		size_t len = strlen(timeString);
+		size_t len = length;
 		if (len >= TIME_MAX_STRING - 1) { len = TIME_MAX_STRING - 1; }
 		memcpy(tstr, timeString, len);
 		tstr[len] = '\0';
@@ -111,7 +230,181 @@ double TimeParse(const char *timeString)
 	}
 	if (index < 5) { err = 1; }
 	if (err != 0) { return 0; }
-	double t = (double)timegm(&tm0) + fraction;
+	timestamp_t t = (timestamp_t)timegm(&tm0) * TIME_TICKS_PER_SECOND + (timestamp_t)floor(fraction * TIME_TICKS_PER_SECOND + 0.5);
 	return t;
 }
 
+
+// Parse a string time representation ("YYYY-MM-DD hh:mm:ss.fff") in to seconds since the epoch
+double TimeParse(const char *timeString)
+{
+	size_t length = strlen(timeString);
+	timestamp_t t;
+	if (!TimeParseFixed(NULL, timeString, length, &t))
+	{
+		t = TimeParseTolerant(timeString, length);
+	}
+	return TimeTicksToSeconds(t);
+}
+
+
+// Convert ticks since the epoch to seconds
+double TimeTicksToSeconds(timestamp_t ticks)
+{
+	return (double)ticks / TIME_TICKS_PER_SECOND;
+}
+
+
+// Convert seconds since the epoch to the nearest tick
+timestamp_t TimeSecondsToTicks(double seconds)
+{
+	return (timestamp_t)llround(seconds * TIME_TICKS_PER_SECOND);
+}
+
+
+// Detect the format of a time string from its value
+static time_format_t TimeDetectFormat(const char *timeString, size_t length)
+{
+	double value;
+	if (!NumericParseDouble(timeString, length, &value))
+	{
+		return TIME_FORMAT_TEXT;
+	}
+
+	// Excel serial days until the year 29349, epoch seconds until the year 5138, otherwise epoch milliseconds
+	if (fabs(value) < 1e7) { return TIME_FORMAT_EXCEL; }
+	if (fabs(value) < 1e11) { return TIME_FORMAT_EPOCH_SECONDS; }
+	return TIME_FORMAT_EPOCH_MILLISECONDS;
+}
+
+
+// Initialize a time parser
+void TimeParserInit(time_parser_t *parser)
+{
+	memset(parser, 0, sizeof(time_parser_t));
+	parser->format = TIME_FORMAT_UNKNOWN;
+}
+
+
+// Parse a time (of the given length, not necessarily NUL-terminated) in the parser's format, using the parser's cache of recent dates
+timestamp_t TimeParserParse(time_parser_t *parser, const char *timeString, size_t length)
+{
+	timestamp_t t;
+	double value;
+
+	// Detect the format from the first non-empty value
+	if (parser->format == TIME_FORMAT_UNKNOWN)
+	{
+		if (length == 0)
+		{
+			return 0;
+		}
+		parser->format = TimeDetectFormat(timeString, length);
+	}
+
+	switch (parser->format)
+	{
+		case TIME_FORMAT_EXCEL:
+			if (!NumericParseDouble(timeString, length, &value)) { return 0; }
+			return TimeSecondsToTicks((value - 25569.0) * 86400.0);			// Days since 1899-12-30
+
+		case TIME_FORMAT_EPOCH_SECONDS:
+			if (!NumericParseDouble(timeString, length, &value)) { return 0; }
+			return TimeSecondsToTicks(value);
+
+		case TIME_FORMAT_EPOCH_MILLISECONDS:
+			if (!NumericParseDouble(timeString, length, &value)) { return 0; }
+			return (timestamp_t)llround(value * TIME_TICKS_PER_SECOND / 1000.0);
+
+		default:
+			if (TimeParseFixed(parser, timeString, length, &t))
+			{
+				return t;
+			}
+			return TimeParseTolerant(timeString, length);
+	}
+}
+
+
+// Civil date for a number of days since the epoch
+static void TimeCivilFromDays(long long days, int *year, int *month, int *day)
+{
+	days += 719468;																		// From 0000-03-01
+	long long era = (days >= 0 ? days : days - 146096) / 146097;
+	int dayOfEra = (int)(days - era * 146097);											// [0, 146096]
+	int yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;	// [0, 399]
+	int dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);		// [0, 365], from March 1st
+	int monthIndex = (5 * dayOfYear + 2) / 153;											// [0, 11], from March
+	*day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+	*month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+	*year = (int)(yearOfEra + era * 400) + (*month <= 2);
+}
+
+
+// Two-digit decimal strings
+static const char timeDigits[] =
+	"00010203040506070809" "10111213141516171819" "20212223242526272829" "30313233343536373839" "40414243444546474849"
+	"50515253545556575859" "60616263646566676869" "70717273747576777879" "80818283848586878889" "90919293949596979899";
+
+#define TIME_PUT2(_p, _value) memcpy((_p), timeDigits + 2 * (_value), 2)
+
+
+// Initialize a time formatter
+void TimeFormatterInit(time_formatter_t *formatter)
+{
+	memset(formatter, 0, sizeof(time_formatter_t));
+}
+
+
+// Format an epoch time as "YYYY-MM-DD hh:mm:ss.fff" in to a buffer of at least TIME_MAX_STRING bytes, using the (optional) formatter's cache of the last date, returns the length
+int TimeFormat(time_formatter_t *formatter, timestamp_t t, char *buffer)
+{
+	// Split in to days, seconds of the day, and milliseconds (rounding down)
+	timestamp_t days = t / ((timestamp_t)86400 * TIME_TICKS_PER_SECOND);
+	timestamp_t ticksOfDay = t % ((timestamp_t)86400 * TIME_TICKS_PER_SECOND);
+	if (ticksOfDay < 0) { ticksOfDay += (timestamp_t)86400 * TIME_TICKS_PER_SECOND; days--; }
+	int secondOfDay = (int)(ticksOfDay / TIME_TICKS_PER_SECOND);
+	int seconds = secondOfDay % 60;
+	int milliseconds = (int)((ticksOfDay % TIME_TICKS_PER_SECOND) * 1000 / TIME_TICKS_PER_SECOND);
+
+	// Date
+	if (formatter != NULL && formatter->valid && formatter->day == days)
+	{
+		memcpy(buffer, formatter->date, 11);
+	}
+	else
+	{
+		int year, month, day;
+		TimeCivilFromDays(days, &year, &month, &day);
+		if (year < 0 || year > 9999)
+		{
+			// Out of range of the fixed layout (bounded, in case of a coarser tick)
+			int length = snprintf(buffer, TIME_MAX_STRING, "%04d-%02d-%02d %02d:%02d:%02d.%03d", year, month, day, secondOfDay / 3600, (secondOfDay / 60) % 60, seconds, milliseconds);
+			return (length < 0) ? 0 : (length > TIME_MAX_STRING - 1) ? TIME_MAX_STRING - 1 : length;
+		}
+		TIME_PUT2(buffer, year / 100);
+		TIME_PUT2(buffer + 2, year % 100);
+		buffer[4] = '-';
+		TIME_PUT2(buffer + 5, month);
+		buffer[7] = '-';
+		TIME_PUT2(buffer + 8, day);
+		buffer[10] = ' ';
+		if (formatter != NULL)
+		{
+			memcpy(formatter->date, buffer, 11);
+			formatter->day = days;
+			formatter->valid = 1;
+		}
+	}
+	// Time
+	TIME_PUT2(buffer + 11, secondOfDay / 3600);
+	buffer[13] = ':';
+	TIME_PUT2(buffer + 14, (secondOfDay / 60) % 60);
+	buffer[16] = ':';
+	TIME_PUT2(buffer + 17, seconds);
+	buffer[19] = '.';
+	buffer[20] = (char)('0' + milliseconds / 100);
+	TIME_PUT2(buffer + 21, milliseconds % 100);
+	buffer[23] = '\0';
+	return 23;
+}
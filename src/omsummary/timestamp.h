@@ -29,17 +29,78 @@
 #ifndef TIMESTAMP_H
 #define TIMESTAMP_H
 
-// Maximum number of bytes in a string time representation ("YYYY-MM-DD hh:mm:ss.fff")
-#define TIME_MAX_STRING 26
+// Maximum number of bytes in a string time representation ("YYYY-MM-DD hh:mm:ss.fff", or "-292275055-05-16 16:47:04.192" for the earliest tick)
+#define TIME_MAX_STRING 32
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Times are held as integer ticks since the epoch
+#ifndef TIME_TICKS_PER_SECOND
+#define TIME_TICKS_PER_SECOND 1000		// Milliseconds
+#endif
+typedef int64_t timestamp_t;
+
+// Number of recent dates remembered by a time parser
+#define TIME_PARSER_CACHE 4
+
+// Time string formats
+typedef enum
+{
+	TIME_FORMAT_UNKNOWN = 0,			// Not yet detected (from the first non-empty value)
+	TIME_FORMAT_TEXT,					// "YYYY-MM-DD hh:mm:ss.fff" (or 'T' separator, or other non-digit separators)
+	TIME_FORMAT_EXCEL,					// Excel serial day number (days since 1899-12-30)
+	TIME_FORMAT_EPOCH_SECONDS,			// Seconds since the epoch
+	TIME_FORMAT_EPOCH_MILLISECONDS,		// Milliseconds since the epoch
+} time_format_t;
+
+// Time parser state: the format, and recent dates and the epoch time at their start (each parser is only used by one thread, e.g. one per column)
+typedef struct
+{
+	struct
+	{
+		char date[10];			// "YYYY-MM-DD"
+		long long midnight;		// Seconds since the epoch at the start of the date
+		int valid;				// Entry is in use
+	} cache[TIME_PARSER_CACHE];
+	int next;					// Next entry to replace
+	time_format_t format;		// Format of the values
+} time_parser_t;
+
+// Time formatter state: the most recently formatted date (each formatter is only used by one thread)
+typedef struct
+{
+	timestamp_t day;			// Days since the epoch of the cached date
+	char date[11];				// "YYYY-MM-DD "
+	int valid;					// The cached date is in use
+} time_formatter_t;
 
 // Returns the number of seconds since the epoch
 double TimeNow(void);
 
-// Convert an epoch time to a string time representation ("YYYY-MM-DD hh:mm:ss.fff")
+// Convert an epoch time to a string time representation ("YYYY-MM-DD hh:mm:ss.fff"), if timeString is NULL a static buffer is used (not thread safe)
 char *TimeString(double epochTime, char *timeString);
 
+// Initialize a time formatter
+void TimeFormatterInit(time_formatter_t *formatter);
+
+// Format an epoch time as "YYYY-MM-DD hh:mm:ss.fff" in to a buffer of at least TIME_MAX_STRING bytes, using the (optional) formatter's cache of the last date, returns the length
+int TimeFormat(time_formatter_t *formatter, timestamp_t epochTime, char *buffer);
+
 // Parse a string time representation ("YYYY-MM-DD hh:mm:ss.fff") in to seconds since the epoch
 double TimeParse(const char *timeString);
 
+// Convert ticks since the epoch to seconds
+double TimeTicksToSeconds(timestamp_t ticks);
+
+// Convert seconds since the epoch to the nearest tick
+timestamp_t TimeSecondsToTicks(double seconds);
+
+// Initialize a time parser (the format is detected from the first non-empty value parsed)
+void TimeParserInit(time_parser_t *parser);
+
+// Parse a time (of the given length, not necessarily NUL-terminated) in the parser's format in to ticks since the epoch, using the parser's cache of recent dates
+timestamp_t TimeParserParse(time_parser_t *parser, const char *timeString, size_t length);
+
 
 #endif